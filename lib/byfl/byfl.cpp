@@ -119,6 +119,7 @@ ofstream *bfbin_file;            // Underlying file for the above
 string bfbin_filename;           // File name associated with the above
 bool bf_abnormal_exit = false;   // false=exit normally; true=get out fast
 bool bf_suppress_counting = false;        // false=normal operation; true=don't update state
+uint64_t bf_sample_threshold = ~uint64_t(0);  // Admit all addresses unless sampling
 static CallStack* call_stack = nullptr;   // The calling process's current call stack
 static string start_time;        // Time at which initialize_byfl() was called
 
@@ -155,6 +156,8 @@ void initialize_byfl (void)
   bf_func_and_parents_id = KeyType_t(0);
   bf_current_func_key = KeyType_t(0);
   call_stack = new CallStack();
+  if (bf_sample_period > 1)
+    bf_sample_threshold = ~uint64_t(0) / bf_sample_period;
   const char* partition = bf_categorize_counters();
   if (partition != NULL)
     bf_record_key(partition, bf_categorize_counters_id);
@@ -439,6 +442,8 @@ private:
            << uint8_t(BINOUT_COL_UINT64) << "Bytes loaded and stored by memcpy and memmove";
     if (bf_unique_bytes)
       *bfbin << uint8_t(BINOUT_COL_UINT64) << "Unique bytes";
+    if (bf_unique_bytes && bf_unique_sketch_bits > 0)
+      *bfbin << uint8_t(BINOUT_COL_UINT64) << "Unique bytes standard error";
     *bfbin << uint8_t(BINOUT_COL_UINT64) << "Invocations";
     if (bf_call_stack)
       *bfbin << uint8_t(BINOUT_COL_STRING) << "Mangled call stack"
@@ -498,6 +503,8 @@ private:
              << func_counters->mem_insts[BF_MEMXFER_BYTES];
       if (bf_unique_bytes)
         *bfbin << num_uniq_bytes;
+      if (bf_unique_bytes && bf_unique_sketch_bits > 0)
+        *bfbin << uint64_t(num_uniq_bytes*HyperLogLog::relative_error(unsigned(bf_unique_sketch_bits)) + 0.5);
       *bfbin << invocations
              << funcname_c
              << demangle_func_name(funcname_c);
@@ -510,6 +517,44 @@ private:
     *bfbin << uint8_t(BINOUT_ROW_NONE);
     delete all_funcs;
 
+    // Output in binary the reuse-distance histogram of each function or call
+    // stack.  Distances beyond the histogram's exact range are binned, so we
+    // report each bin's range.
+    key2hist_t& func_reuse = bf_get_reuse_distance_by_func();
+    if (func_reuse.size() > 0) {
+      vector<KeyType_t>* reuse_funcs = func_reuse.sorted_keys(compare_keys_to_names);
+      uint64_t dist_scale = bf_sample_period*bf_reuse_granularity;
+      *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Reuse distance by function";
+      if (bf_call_stack)
+        *bfbin << uint8_t(BINOUT_COL_STRING) << "Mangled call stack"
+               << uint8_t(BINOUT_COL_STRING) << "Demangled call stack";
+      else
+        *bfbin << uint8_t(BINOUT_COL_STRING) << "Mangled function name"
+               << uint8_t(BINOUT_COL_STRING) << "Demangled function name";
+      *bfbin << uint8_t(BINOUT_COL_UINT64) << "Distance in bytes"
+             << uint8_t(BINOUT_COL_UINT64) << "Maximum distance in bytes"
+             << uint8_t(BINOUT_COL_UINT64) << "Tally"
+             << uint8_t(BINOUT_COL_NONE);
+      for (auto fn_iter = reuse_funcs->begin(); fn_iter != reuse_funcs->end(); fn_iter++) {
+        const char* funcname_c = bf_string_to_symbol(key_to_func()[*fn_iter].c_str());
+        string demangled_name = demangle_func_name(funcname_c);
+        const HdrHistogram& histogram = *func_reuse[*fn_iter];
+        for (size_t bin = 0; bin < histogram.size(); ++bin) {
+          uint64_t tally = histogram[bin]*bf_sample_period;
+          if (tally == 0)
+            continue;
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << funcname_c
+                 << demangled_name
+                 << histogram.bin_min(bin)*dist_scale
+                 << histogram.bin_max(bin)*dist_scale
+                 << tally;
+        }
+      }
+      *bfbin << uint8_t(BINOUT_ROW_NONE);
+      delete reuse_funcs;
+    }
+
     // Output, both textually and in binary, invocation tallies for
     // all called functions, not just instrumented functions.
     vector<const char*> all_called_funcs;
@@ -688,10 +733,13 @@ private:
     uint64_t global_bytes = counter_totals.loads + counter_totals.stores;
     uint64_t global_mem_ops = counter_totals.load_ins + counter_totals.store_ins;
     uint64_t global_unique_bytes = 0;
-    vector<uint64_t>* reuse_hist;   // Histogram of reuse distances
+    HdrHistogram* reuse_hist;       // Histogram of reuse distances
     uint64_t reuse_unique;          // Unique bytes as measured by the reuse-distance calculator
     bf_get_reuse_distance(&reuse_hist, &reuse_unique);
-    if (reuse_unique > 0)
+    HdrHistogram* private_hist;     // Sum of the per-thread reuse-distance histograms
+    uint64_t private_median, private_mad;  // Median and MAD of private reuse distances
+    bool private_reuse = bf_get_private_reuse_distance(&private_hist, &private_median, &private_mad);
+    if (reuse_unique > 0 && bf_reuse_granularity == 1)
       global_unique_bytes = reuse_unique;
     else
       if (bf_unique_bytes && !partition)
@@ -699,6 +747,19 @@ private:
     uint64_t uti = 0, mti = 0;
     if (bf_unique_bytes && bf_strides && !partition)
       bf_partition_unique_addresses(&uti, &mti);
+    vector<uint64_t> thread_unique_bytes;  // Unique bytes touched by each thread
+    uint64_t thread_shared_bytes = 0;      // Bytes touched by more than one thread
+    bool per_thread_unique = false;
+    if (bf_unique_bytes && !partition)
+      per_thread_unique = bf_mem_footprint
+        ? bf_get_thread_unique_bytes_tb(&thread_unique_bytes, &thread_shared_bytes)
+        : bf_get_thread_unique_bytes(&thread_unique_bytes, &thread_shared_bytes);
+    uint64_t page_table_bytes = 0;  // Memory used to track unique bytes
+    if (bf_unique_bytes && !partition) {
+      page_table_bytes = bf_mem_footprint ? bf_unique_bytes_memory_tb() : bf_unique_bytes_memory();
+      if (bf_strides)
+        page_table_bytes += bf_strides_memory();
+    }
 
     // Prepare the tag to use for output, and indicate that we want to
     // use separators in numerical output.
@@ -763,6 +824,21 @@ private:
                << uti + mti - global_unique_bytes << " overlapped)\n";
         else
           *bfout << tag << ": " << setw(25) << global_unique_bytes << " unique bytes\n";
+      *bfout << tag << ": " << setw(25) << page_table_bytes
+             << " bytes of page tables used to find unique bytes\n";
+      if (per_thread_unique)
+        *bfout << tag << ": " << setw(25) << thread_shared_bytes
+               << " unique bytes touched by more than one of "
+               << thread_unique_bytes.size() << " threads\n";
+      if (bf_per_func && bf_unique_sketch_bits > 0)
+        *bfout << tag << ": " << setw(24)
+               << fixed << setprecision(4)
+               << HyperLogLog::relative_error(unsigned(bf_unique_sketch_bits))*100.0
+               << "% standard error in per-function unique bytes ("
+               << (uint64_t(1) << bf_unique_sketch_bits) << "-register sketches)\n";
+      if (bf_per_func && bf_unique_sketch_bits > 0 && bf_unique_sketch_granularity > 1)
+        *bfout << tag << ": " << setw(25) << bf_unique_sketch_granularity
+               << " bytes per per-function unique-byte granule\n";
     }
     if (bf_mem_footprint && !partition)
       *bfout << tag << ": " << setw(25) << bytes_for_50pct_hits
@@ -847,6 +923,20 @@ private:
       *bfbin << uint8_t(BINOUT_COL_UINT64)
              << "Unique addresses loaded or stored"
              << global_unique_bytes;
+      *bfbin << uint8_t(BINOUT_COL_UINT64)
+             << "Page-table memory used to find unique addresses (bytes)"
+             << page_table_bytes;
+      if (per_thread_unique)
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Unique addresses shared by threads"
+               << thread_shared_bytes;
+      if (bf_per_func && bf_unique_sketch_bits > 0)
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Per-function unique-address sketch registers"
+               << (uint64_t(1) << bf_unique_sketch_bits)
+               << uint8_t(BINOUT_COL_UINT64)
+               << "Per-function unique-address sketch granularity (bytes)"
+               << bf_unique_sketch_granularity;
       if (bf_strides)
         *bfbin << uint8_t(BINOUT_COL_UINT64)
                << "Unique addresses from single-target loads and stores"
@@ -877,6 +967,54 @@ private:
       *bfbin << uint8_t(BINOUT_COL_UINT64)
              << "MAD reuse distance"
              << mad_value;
+      *bfbin << uint8_t(BINOUT_COL_UINT64)
+             << "Exact reuse-distance histogram bins"
+             << reuse_hist->get_exact_limit()
+             << uint8_t(BINOUT_COL_UINT64)
+             << "Reuse-distance histogram bins per power of two"
+             << reuse_hist->get_sub_bins();
+      if (bf_sample_period > 1) {
+        uint64_t sampled_addrs, total_addrs;
+        bf_get_reuse_sampling(&sampled_addrs, &total_addrs);
+        *bfout << tag << ": " << setw(25) << sampled_addrs
+               << " addresses sampled for reuse distance (1 in "
+               << bf_sample_period << "; "
+               << fixed << setw(5) << setprecision(1)
+               << sampling_error(sampled_addrs, total_addrs)*100.0
+               << "% estimated error)\n";
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Reuse-distance sampled addresses"
+               << sampled_addrs;
+      }
+      if (bf_reuse_granularity > 1) {
+        *bfout << tag << ": " << setw(25) << bf_reuse_granularity
+               << " bytes per reuse-distance granule\n";
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Reuse-distance granularity (bytes)"
+               << bf_reuse_granularity;
+      }
+      if (bf_reuse_error_ppm > 0) {
+        *bfout << tag << ": " << setw(24)
+               << fixed << setprecision(4) << bf_reuse_error_ppm/1.0e4
+               << "% maximum relative error in reuse distance\n";
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Reuse-distance maximum relative error (ppm)"
+               << bf_reuse_error_ppm;
+      }
+      if (private_reuse) {
+        *bfout << tag << ": " << setw(25);
+        if (private_median == ~(uint64_t)0)
+          *bfout << "infinite" << " median private (per-thread) reuse distance\n";
+        else
+          *bfout << private_median << " median private (per-thread) reuse distance (+/- "
+                 << private_mad << ")\n";
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "Median private reuse distance"
+               << private_median;
+        *bfbin << uint8_t(BINOUT_COL_UINT64)
+               << "MAD private reuse distance"
+               << private_mad;
+      }
     }
     *bfout << tag << ": " << separator << '\n';
 
@@ -1058,17 +1196,134 @@ private:
       *bfbin << uint8_t(BINOUT_ROW_NONE);
     }
 
-    // Output a table of reuse distances in binary format.
+    // Output a table of reuse distances in binary format.  Distances beyond
+    // the histogram's exact range are binned, so we report each bin's range.
     if (reuse_unique > 0) {
       *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Reuse distance";
       *bfbin << uint8_t(BINOUT_COL_UINT64) << "Distance in bytes"
+             << uint8_t(BINOUT_COL_UINT64) << "Maximum distance in bytes"
              << uint8_t(BINOUT_COL_UINT64) << "Tally"
              << uint8_t(BINOUT_COL_NONE);
-      uint64_t dist = 0;
-      for (auto iter = reuse_hist->begin(); iter != reuse_hist->end(); iter++, dist++)
-        if (*iter > 0)
-          *bfbin << uint8_t(BINOUT_ROW_DATA) << dist << *iter;
+      uint64_t dist_scale = bf_sample_period*bf_reuse_granularity;
+      for (size_t bin = 0; bin < reuse_hist->size(); bin++)
+        if ((*reuse_hist)[bin] > 0)
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << reuse_hist->bin_min(bin)*dist_scale
+                 << reuse_hist->bin_max(bin)*dist_scale
+                 << (*reuse_hist)[bin]*bf_sample_period;
       *bfbin << uint8_t(BINOUT_ROW_NONE);
+
+      // If each thread computed its own reuse distance, output the sum of
+      // the per-thread (private) distances as well.
+      if (private_reuse) {
+        *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Private reuse distance";
+        *bfbin << uint8_t(BINOUT_COL_UINT64) << "Distance in bytes"
+               << uint8_t(BINOUT_COL_UINT64) << "Maximum distance in bytes"
+               << uint8_t(BINOUT_COL_UINT64) << "Tally"
+               << uint8_t(BINOUT_COL_NONE);
+        for (size_t bin = 0; bin < private_hist->size(); bin++)
+          if ((*private_hist)[bin] > 0)
+            *bfbin << uint8_t(BINOUT_ROW_DATA)
+                   << private_hist->bin_min(bin)*dist_scale
+                   << private_hist->bin_max(bin)*dist_scale
+                   << (*private_hist)[bin]*bf_sample_period;
+        *bfbin << uint8_t(BINOUT_ROW_NONE);
+      }
+    }
+
+    // Output in binary a summary of each reuse-distance window followed by
+    // the reuse distances observed during each window.
+    if (reuse_unique > 0 && !partition) {
+      const vector<ReuseWindow>& windows = bf_get_reuse_windows();
+      if (windows.size() > 0) {
+        uint64_t dist_scale = bf_sample_period*bf_reuse_granularity;
+        *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Reuse-distance windows";
+        *bfbin << uint8_t(BINOUT_COL_UINT64) << "Window"
+               << uint8_t(BINOUT_COL_UINT64) << "First memory access"
+               << uint8_t(BINOUT_COL_UINT64) << "Memory accesses"
+               << uint8_t(BINOUT_COL_UINT64) << "Start time (microseconds)"
+               << uint8_t(BINOUT_COL_UINT64) << "Duration (microseconds)"
+               << uint8_t(BINOUT_COL_UINT64) << "Unique bytes first touched"
+               << uint8_t(BINOUT_COL_UINT64) << "Median reuse distance"
+               << uint8_t(BINOUT_COL_UINT64) << "MAD reuse distance"
+               << uint8_t(BINOUT_COL_NONE);
+        for (size_t w = 0; w < windows.size(); w++) {
+          const ReuseWindow& window = windows[w];
+          uint64_t median = window.median;
+          uint64_t mad = window.mad;
+          if (median != ~(uint64_t)0) {
+            median *= dist_scale;
+            mad *= dist_scale;
+          }
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << uint64_t(w)
+                 << window.first_access
+                 << window.num_accesses
+                 << window.start_usecs
+                 << window.duration_usecs
+                 << window.unique_addrs*dist_scale
+                 << median
+                 << mad;
+        }
+        *bfbin << uint8_t(BINOUT_ROW_NONE);
+
+        *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Reuse distance by window";
+        *bfbin << uint8_t(BINOUT_COL_UINT64) << "Window"
+               << uint8_t(BINOUT_COL_UINT64) << "Distance in bytes"
+               << uint8_t(BINOUT_COL_UINT64) << "Maximum distance in bytes"
+               << uint8_t(BINOUT_COL_UINT64) << "Tally"
+               << uint8_t(BINOUT_COL_NONE);
+        for (size_t w = 0; w < windows.size(); w++)
+          for (auto iter = windows[w].bins.cbegin(); iter != windows[w].bins.cend(); iter++)
+            *bfbin << uint8_t(BINOUT_ROW_DATA)
+                   << uint64_t(w)
+                   << get<0>(*iter)*dist_scale
+                   << get<1>(*iter)*dist_scale
+                   << get<2>(*iter)*bf_sample_period;
+        *bfbin << uint8_t(BINOUT_ROW_NONE);
+      }
+    }
+
+    // Output in binary the number of unique bytes each thread touched.
+    if (per_thread_unique) {
+      *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Unique bytes by thread";
+      *bfbin << uint8_t(BINOUT_COL_UINT64) << "Thread"
+             << uint8_t(BINOUT_COL_UINT64) << "Unique bytes"
+             << uint8_t(BINOUT_COL_NONE);
+      for (size_t t = 0; t < thread_unique_bytes.size(); t++)
+        *bfbin << uint8_t(BINOUT_ROW_DATA)
+               << uint64_t(t)
+               << thread_unique_bytes[t];
+      *bfbin << uint8_t(BINOUT_ROW_NONE);
+    }
+
+    // Output in binary the growth of the program's memory footprint during
+    // each window of execution.
+    if (bf_unique_bytes && !partition) {
+      const vector<UniqueWindow>& windows = bf_get_unique_windows();
+      if (windows.size() > 0) {
+        *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Unique-byte windows";
+        *bfbin << uint8_t(BINOUT_COL_UINT64) << "Window"
+               << uint8_t(BINOUT_COL_UINT64) << "First memory access"
+               << uint8_t(BINOUT_COL_UINT64) << "Memory accesses"
+               << uint8_t(BINOUT_COL_UINT64) << "Start time (microseconds)"
+               << uint8_t(BINOUT_COL_UINT64) << "Duration (microseconds)"
+               << uint8_t(BINOUT_COL_UINT64) << "Unique bytes first touched"
+               << uint8_t(BINOUT_COL_UINT64) << "Cumulative unique bytes"
+               << uint8_t(BINOUT_COL_NONE);
+        for (size_t w = 0; w < windows.size(); w++) {
+          const UniqueWindow& window = windows[w];
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << uint64_t(w)
+                 << window.first_access
+                 << window.num_accesses
+                 << window.start_usecs
+                 << window.duration_usecs
+                 << window.new_bytes
+                 << window.total_bytes;
+        }
+        *bfbin << uint8_t(BINOUT_ROW_NONE);
+      }
     }
 
     // Report a bunch of derived measurements (textually only).
@@ -1154,19 +1409,33 @@ private:
       *bfout << tag << ": " << separator << '\n';}
   }
 
-  // Report cache performance if it was used.
+  // Estimate the relative error introduced by spatial sampling as the
+  // amount by which the scaled-up number of sampled accesses misses the
+  // true number of accesses.
+  double sampling_error (uint64_t sampled, uint64_t total) {
+    if (total == 0)
+      return 0.0;
+    uint64_t scaled = sampled*bf_sample_period;
+    uint64_t deviation = scaled > total ? scaled - total : total - scaled;
+    return double(deviation)/double(total);
+  }
+
+  // Report cache performance if it was used.  If the cache model was fed
+  // only a spatial sample of cache lines, scale tallies and the number of
+  // intervening lines in each LRU search distance by the sample period.
   void report_cache (ByteFlopCounters& counter_totals) {
     // Accumulate our measured cache data.
     const int n = 3;   // n different dump files are created.
     uint64_t accesses[n] = {bf_get_private_cache_accesses(),
                             bf_get_shared_cache_accesses(),
                             bf_get_shared_cache_accesses()};
-    vector<unordered_map<uint64_t,uint64_t> > hits[n] = {bf_get_private_cache_hits(),
-                                                         bf_get_shared_cache_hits(),
-                                                         bf_get_remote_shared_cache_hits()};
-    uint64_t cold_misses[n] = {bf_get_private_cold_misses(),
-                               bf_get_shared_cold_misses(),
-                               bf_get_shared_cold_misses()};
+    vector<LogHistogram> private_hits(bf_get_private_cache_hits());
+    const vector<LogHistogram>* hits[n] = {&private_hits,
+                                           &bf_get_shared_cache_hits(),
+                                           &bf_get_remote_shared_cache_hits()};
+    uint64_t cold_misses[n] = {bf_get_private_cold_misses()*bf_sample_period,
+                               bf_get_shared_cold_misses()*bf_sample_period,
+                               bf_get_shared_cold_misses()*bf_sample_period};
     uint64_t misaligned_mem_ops[n] = {bf_get_private_misaligned_mem_ops(),
                                       bf_get_shared_misaligned_mem_ops(),
                                       bf_get_shared_misaligned_mem_ops()};
@@ -1190,21 +1459,32 @@ private:
       *bfbin << uint8_t(BINOUT_COL_UINT64) << "Total cache accesses" << accesses[i]
              << uint8_t(BINOUT_COL_UINT64) << "Cold misses" << cold_misses[i]
              << uint8_t(BINOUT_COL_UINT64) << "Line size" << bf_line_size
+             << uint8_t(BINOUT_COL_UINT64) << "Exact LRU search distances" << LogHistogram::exact_limit
+             << uint8_t(BINOUT_COL_UINT64) << "Histogram bins per power of two" << LogHistogram::sub_bins
              << uint8_t(BINOUT_COL_NONE);
 
-      // Dump pairs of {lines searched, tally} for each set size.
+      // Dump {lines searched, tally} for each set size.  Search distances
+      // beyond the exact range are binned, so we report each bin's range
+      // (and only its lower bound in the text dump).
       *bfbin << uint8_t(BINOUT_TABLE_BASIC) << table_names[i] + " model data";
       *bfbin << uint8_t(BINOUT_COL_UINT64) << "Set size"
              << uint8_t(BINOUT_COL_UINT64) << "LRU search distance"
+             << uint8_t(BINOUT_COL_UINT64) << "Maximum LRU search distance"
              << uint8_t(BINOUT_COL_UINT64) << "Tally"
              << uint8_t(BINOUT_COL_NONE);
       for (uint64_t set = 0; set < bf_max_set_bits; ++set) {
         uint64_t num_sets = 1<<set;
+        const LogHistogram& histogram = (*hits[i])[set];
         dumpfile << "Sets\t" << num_sets << endl;
-        for (const auto& elem : hits[i][set]) {
-          dumpfile << elem.first << "\t" << elem.second << endl;
+        for (size_t bin = 0; bin < LogHistogram::num_bins; ++bin) {
+          uint64_t tally = histogram[bin]*bf_sample_period;
+          if (tally == 0)
+            continue;
+          uint64_t min_dist = (LogHistogram::bin_min(bin) - 1)*bf_sample_period + 1;
+          uint64_t max_dist = LogHistogram::bin_max(bin)*bf_sample_period;
+          dumpfile << min_dist << "\t" << tally << endl;
           *bfbin << uint8_t(BINOUT_ROW_DATA)
-                 << num_sets << elem.first << elem.second;
+                 << num_sets << min_dist << max_dist << tally;
         }
       }
 
@@ -1221,6 +1501,21 @@ private:
            << global_mem_ops - misaligned_mem_ops[0] << " aligned + "
            << misaligned_mem_ops[0] << " misaligned memory ops; "
            << "line size = " << bf_line_size << " bytes)\n";
+    uint64_t sampled_accesses = bf_get_private_sampled_cache_accesses();
+    if (bf_sample_period > 1)
+      *bfout << tag << ": " << setw(25)
+             << sampled_accesses << " cache lines sampled (1 in "
+             << bf_sample_period << "; "
+             << fixed << setw(5) << setprecision(1)
+             << sampling_error(sampled_accesses, accesses[0])*100.0
+             << "% estimated error)\n";
+    uint64_t prefetches = bf_get_private_prefetches()*bf_sample_period;
+    if (prefetches > 0)
+      *bfout << tag << ": " << setw(25)
+             << prefetches << " cache lines prefetched\n";
+    bf_report_cache_hierarchy();
+    bf_report_tlb_model();
+    bf_report_cache_sharing();
     *bfout << tag << ": " << separator << '\n';
 
     // Output binary summary information.
@@ -1229,7 +1524,77 @@ private:
            << uint8_t(BINOUT_COL_UINT64) << "Cache accesses" << accesses[0]
            << uint8_t(BINOUT_COL_UINT64) << "Aligned memory operations" << global_mem_ops - misaligned_mem_ops[0]
            << uint8_t(BINOUT_COL_UINT64) << "Misaligned memory operations" << misaligned_mem_ops[0]
+           << uint8_t(BINOUT_COL_UINT64) << "Sample period" << bf_sample_period
+           << uint8_t(BINOUT_COL_UINT64) << "Sampled cache accesses" << sampled_accesses
+           << uint8_t(BINOUT_COL_UINT64) << "Store cache accesses" << bf_get_private_store_accesses()*bf_sample_period
+           << uint8_t(BINOUT_COL_UINT64) << "Prefetches" << prefetches
            << uint8_t(BINOUT_COL_NONE);
+
+    // Output the write-allocate fills and write-backs a write-back,
+    // write-allocate cache would incur for each set count and a range of
+    // power-of-two associativities, and the lines it would hold dirty at
+    // the end of the run.
+    for (int i = 0; i < 2; ++i) {
+      *bfbin << uint8_t(BINOUT_TABLE_BASIC) << table_names[i] + " write traffic";
+      *bfbin << uint8_t(BINOUT_COL_UINT64) << "Set size"
+             << uint8_t(BINOUT_COL_UINT64) << "Associativity"
+             << uint8_t(BINOUT_COL_UINT64) << "Capacity (bytes)"
+             << uint8_t(BINOUT_COL_UINT64) << "Write-allocate fills"
+             << uint8_t(BINOUT_COL_UINT64) << "Write-backs"
+             << uint8_t(BINOUT_COL_UINT64) << "Dirty lines at exit"
+             << uint8_t(BINOUT_COL_NONE);
+      for (uint64_t set = 0; set < bf_max_set_bits; ++set) {
+        uint64_t num_sets = 1<<set;
+        // Stop at the largest associativity whose counts are exact.
+        for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2) {
+          // Convert the associativity to a number of sampled lines.
+          uint64_t sampled_ways = (ways - 1)/bf_sample_period + 1;
+          uint64_t fills, writebacks, dirty;
+          if (i == 0)
+            bf_get_private_write_traffic(set, sampled_ways, &fills, &writebacks, &dirty);
+          else
+            bf_get_shared_write_traffic(set, sampled_ways, &fills, &writebacks, &dirty);
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << num_sets << ways << num_sets*ways*bf_line_size
+                 << fills*bf_sample_period << writebacks*bf_sample_period
+                 << dirty*bf_sample_period;
+        }
+      }
+      *bfbin << uint8_t(BINOUT_ROW_NONE);
+    }
+
+    // Output the prefetch fills a cache would incur for each set count and
+    // a range of power-of-two associativities, split into prefetched lines
+    // that were demanded before being evicted (useful) and those that were
+    // not (useless).
+    if (prefetches == 0)
+      return;
+    for (int i = 0; i < 2; ++i) {
+      *bfbin << uint8_t(BINOUT_TABLE_BASIC) << table_names[i] + " prefetch traffic";
+      *bfbin << uint8_t(BINOUT_COL_UINT64) << "Set size"
+             << uint8_t(BINOUT_COL_UINT64) << "Associativity"
+             << uint8_t(BINOUT_COL_UINT64) << "Capacity (bytes)"
+             << uint8_t(BINOUT_COL_UINT64) << "Prefetch fills"
+             << uint8_t(BINOUT_COL_UINT64) << "Useful prefetches"
+             << uint8_t(BINOUT_COL_UINT64) << "Useless prefetches"
+             << uint8_t(BINOUT_COL_NONE);
+      for (uint64_t set = 0; set < bf_max_set_bits; ++set) {
+        uint64_t num_sets = 1<<set;
+        for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2) {
+          uint64_t sampled_ways = (ways - 1)/bf_sample_period + 1;
+          uint64_t fills, useful;
+          if (i == 0)
+            bf_get_private_prefetch_traffic(set, sampled_ways, &fills, &useful);
+          else
+            bf_get_shared_prefetch_traffic(set, sampled_ways, &fills, &useful);
+          *bfbin << uint8_t(BINOUT_ROW_DATA)
+                 << num_sets << ways << num_sets*ways*bf_line_size
+                 << fills*bf_sample_period << useful*bf_sample_period
+                 << (fills - useful)*bf_sample_period;
+        }
+      }
+      *bfbin << uint8_t(BINOUT_ROW_NONE);
+    }
   }
 
   // Report miscellaneous information in the binary output file.
@@ -36,7 +36,10 @@ namespace bytesflops {
 
 #include "byfl-common.h"
 #include "cachemap.h"
+#include "flatmap.h"
 #include "pagetable.h"
+#include "loghist.h"
+#include "hyperloglog.h"
 #include "binaryoutput.h"
 
 // The following constants are defined by the instrumented code.
@@ -47,6 +50,9 @@ extern uint64_t bf_bb_merge;         // Number of basic blocks to merge to compr
 extern uint8_t  bf_call_stack;       // 1=maintain a function call stack
 extern uint8_t  bf_every_bb;         // 1=tally and output per-basic-block data
 extern uint64_t bf_max_reuse_distance;  // Maximum reuse distance to consider */
+extern uint64_t bf_reuse_granularity;   // Bytes per block over which to compute reuse distance
+extern uint64_t bf_reuse_error_ppm;     // Relative error (in parts per million) allowed in reuse distance; 0=exact
+extern uint64_t bf_reuse_bin_bits;      // log2 of the reuse-distance histogram bins per power of two
 extern const char* bf_option_string; // -bf-* command-line options
 extern uint8_t  bf_per_func;         // 1=tally and output per-function data
 extern uint8_t  bf_mem_footprint;    // 1=keep track of how many times each byte of memory is accessed
@@ -54,12 +60,15 @@ extern uint8_t  bf_tally_inst_mix;   // 1=maintain instruction-mix histogram
 extern uint8_t  bf_tally_inst_deps;  // 1=maintain instruction-dependency histogram
 extern uint8_t  bf_types;            // 1=count loads/stores per type
 extern uint8_t  bf_unique_bytes;     // 1=tally and output unique bytes
+extern uint64_t bf_unique_sketch_bits;  // log2 of the registers per per-function unique-byte sketch; 0=exact
+extern uint64_t bf_unique_sketch_granularity;  // Bytes per block counted by those sketches
 extern uint8_t  bf_vectors;          // 1=bin then output vector characteristics
 extern uint8_t  bf_cache_model;      // 1=use the simple cache model
 extern uint8_t  bf_data_structs;     // 1=tally and output counters by data structure
 extern uint8_t  bf_strides;          // 1=tally and output information about access strides
 extern uint64_t bf_line_size;        // cache line size in bytes
 extern uint64_t bf_max_set_bits;     // log base 2 of max number of sets to model
+extern uint64_t bf_sample_period;    // model only ~1 in this many addresses/lines
 
 // The following globals are defined by the instrumented code.
 extern uint64_t bf_fmap_cnt;
@@ -77,12 +86,19 @@ namespace bytesflops {
   // one in which they're defined.
   extern void bf_get_address_tally_hist (vector<bf_addr_tally_t>& histogram, uint64_t* total);
   extern void bf_get_median_reuse_distance(uint64_t* median_value, uint64_t* mad_value);
-  extern void bf_get_reuse_distance(vector<uint64_t>** hist, uint64_t* unique_addrs);
+  extern void bf_get_reuse_distance(HdrHistogram** hist, uint64_t* unique_addrs);
+  extern bool bf_get_private_reuse_distance(HdrHistogram** hist, uint64_t* median_value, uint64_t* mad_value);
+  extern void bf_get_reuse_sampling(uint64_t* sampled_addrs, uint64_t* total_addrs);
   extern void bf_get_vector_statistics(const char* tag, uint64_t* num_ops, uint64_t* total_elts, uint64_t* total_bits);
   extern void bf_get_vector_statistics(uint64_t* num_ops, uint64_t* total_elts, uint64_t* total_bits);
   extern void bf_abend(void) __attribute__ ((noreturn));
+  extern uint64_t bf_parse_size(const char* size_str, char** end);
   extern void bf_report_vector_operations(void);
   extern void bf_report_data_struct_counts(void);
+  extern void bf_report_cache_hierarchy(void);
+  extern void bf_report_tlb_model(void);
+  extern void bf_report_cache_sharing(void);
+  extern string bf_describe_data_struct(uint64_t addr);
   extern void bf_report_bb_execution(void);
   extern void bf_partition_unique_addresses(uint64_t* uti, uint64_t *mti);
   extern void bf_report_strides_by_call_point(void);
@@ -90,6 +106,12 @@ namespace bytesflops {
   extern uint64_t bf_tally_unique_addresses_tb(const char* funcname);
   extern uint64_t bf_tally_unique_addresses_tb(void);
   extern uint64_t bf_tally_unique_addresses(void);
+  extern uint64_t bf_unique_bytes_memory(void);
+  extern uint64_t bf_unique_bytes_memory_tb(void);
+  extern void bf_record_unique_growth(uint64_t new_bytes);
+  extern bool bf_get_thread_unique_bytes(vector<uint64_t>* per_thread, uint64_t* shared);
+  extern bool bf_get_thread_unique_bytes_tb(vector<uint64_t>* per_thread, uint64_t* shared);
+  extern uint64_t bf_strides_memory(void);
   extern "C" const char* bf_string_to_symbol(const char *nonunique);
   extern void initialize_byfl(void);
   extern void initialize_bblocks(void);
@@ -104,14 +126,22 @@ namespace bytesflops {
   extern void initialize_cache(void);
   extern void finalize_bblocks(void);
   extern uint64_t bf_get_private_cache_accesses(void);
-  extern vector<unordered_map<uint64_t,uint64_t> > bf_get_private_cache_hits(void);
+  extern uint64_t bf_get_private_sampled_cache_accesses(void);
+  extern vector<LogHistogram> bf_get_private_cache_hits(void);
+  extern uint64_t bf_get_private_store_accesses(void);
+  extern void bf_get_private_write_traffic(uint64_t set, uint64_t ways, uint64_t* fills, uint64_t* writebacks, uint64_t* dirty);
+  extern void bf_get_shared_write_traffic(uint64_t set, uint64_t ways, uint64_t* fills, uint64_t* writebacks, uint64_t* dirty);
+  extern uint64_t bf_get_private_prefetches(void);
+  extern void bf_get_private_prefetch_traffic(uint64_t set, uint64_t ways, uint64_t* fills, uint64_t* useful);
+  extern void bf_get_shared_prefetch_traffic(uint64_t set, uint64_t ways, uint64_t* fills, uint64_t* useful);
+  extern void bf_prefetch_stride(uint64_t addr, int64_t stride);
   extern uint64_t bf_get_private_cold_misses(void);
   extern uint64_t bf_get_private_misaligned_mem_ops(void);
   extern uint64_t bf_get_shared_cache_accesses(void);
-  extern vector<unordered_map<uint64_t,uint64_t> > bf_get_shared_cache_hits(void);
+  extern const vector<LogHistogram>& bf_get_shared_cache_hits(void);
   extern uint64_t bf_get_shared_cold_misses(void);
   extern uint64_t bf_get_shared_misaligned_mem_ops(void);
-  extern vector<unordered_map<uint64_t,uint64_t> > bf_get_remote_shared_cache_hits(void);
+  extern const vector<LogHistogram>& bf_get_remote_shared_cache_hits(void);
   extern bool suppress_output(void);
 
   // The following library variables are used in files other than the
@@ -121,6 +151,20 @@ namespace bytesflops {
   extern const char* opcode2name[];         // Map from an LLVM opcode to its name
   extern KeyType_t bf_func_and_parents_id;  // Top of the complete_call_stack stack
   extern bool bf_suppress_counting;         // Whether to update Byfl data structures
+  extern uint64_t bf_sample_threshold;      // Largest address hash admitted by spatial sampling
+
+  // Spatial sampling (as in SHARDS) models an address or cache line only if
+  // a hash of it lies below a threshold.  Every access to a given address is
+  // therefore either modeled or ignored, so reuse is preserved among the
+  // sampled addresses, and results can be scaled up by bf_sample_period.
+  static inline bool bf_sample_admits (uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key <= bf_sample_threshold;
+  }
 
   // Encapsulate of all of our basic-block counters into a single structure.
   class ByteFlopCounters {
@@ -200,11 +244,41 @@ typedef CachedUnorderedMap<KeyType_t, ByteFlopCounters*> key2bfc_t;
 typedef CachedUnorderedMap<MapKey_t, ByteFlopCounters*> str2bfc_t;
 typedef str2bfc_t::iterator counter_iterator;
 
+// Define a datatype for tracking reuse distance on a per-function basis.
+typedef CachedUnorderedMap<KeyType_t, HdrHistogram*> key2hist_t;
+
+// Define a datatype for the reuse distances observed during one window of
+// execution.  Distances and unique addresses are unscaled and in granules.
+struct ReuseWindow {
+  uint64_t first_access;     // Number of memory accesses preceding the window
+  uint64_t num_accesses;     // Number of memory accesses in the window
+  uint64_t start_usecs;      // Microseconds from the first access to the window's start
+  uint64_t duration_usecs;   // Microseconds the window lasted
+  uint64_t unique_addrs;     // Addresses first touched during the window
+  uint64_t median;           // Median reuse distance within the window
+  uint64_t mad;              // Median absolute deviation of the above
+  vector<tuple<uint64_t, uint64_t, uint64_t> > bins;  // {min distance, max distance, tally}
+};
+
+// Define a datatype for the growth of the program's memory footprint during
+// one window of execution.
+struct UniqueWindow {
+  uint64_t first_access;     // Number of memory accesses preceding the window
+  uint64_t num_accesses;     // Number of memory accesses in the window
+  uint64_t start_usecs;      // Microseconds from the first access to the window's start
+  uint64_t duration_usecs;   // Microseconds the window lasted
+  uint64_t new_bytes;        // Bytes first touched during the window
+  uint64_t total_bytes;      // Bytes first touched during this or any earlier window
+};
+
 // The following library variables are used in files other than the one in
 // which they're defined.
 extern ByteFlopCounters global_totals;    // Global tallies of all of our counters
 extern key2bfc_t& per_func_totals(void);
 extern str2bfc_t& user_defined_totals(void);
+extern key2hist_t& bf_get_reuse_distance_by_func(void);
+extern const vector<ReuseWindow>& bf_get_reuse_windows(void);
+extern const vector<UniqueWindow>& bf_get_unique_windows(void);
 
 }
 
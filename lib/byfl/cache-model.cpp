@@ -8,49 +8,148 @@
 #include <iterator>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <fstream>
 
 #include "byfl.h"
+#include "reuse-dist.h"
 
 namespace bytesflops {
 static __thread unsigned cache_id = 0;
+extern BinaryOStream* bfbin;
+extern ostream* bfout;
 }
 using namespace bytesflops;
 using namespace std;
 
+// Define the ways we know to compute LRU stack distances.
+enum CacheEngine {
+  CACHE_ENGINE_LINEAR,   // Linear search of a single LRU stack
+  CACHE_ENGINE_TREE      // Logarithmic search of one tree per set
+};
+
 class Cache {
   public:
-    void access(uint64_t baseaddr, uint64_t numaddrs);
-    Cache(uint64_t line_size, uint64_t max_set_bits, bool record_thread_id) :
-      line_size_{line_size}, accesses_{0}, misaligned_mem_ops_{0},
+    void access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                bool is_store);
+    void prefetch(uint64_t addr, unsigned thread_id);
+    Cache(uint64_t line_size, uint64_t max_set_bits, bool record_thread_id,
+          CacheEngine engine) :
+      line_size_{line_size}, accesses_{0}, sampled_accesses_{0}, misaligned_mem_ops_{0},
       log2_line_size_{0}, max_set_bits_{max_set_bits}, cold_misses_{0},
       hits_(max_set_bits_), record_thread_id_{record_thread_id},
-      remote_hits_(max_set_bits_) {
+      remote_hits_(record_thread_id ? max_set_bits_ : 0), store_accesses_{0},
+      store_cold_misses_{0}, store_hits_(max_set_bits_),
+      writeback_begins_(max_set_bits_), writeback_ends_(max_set_bits_),
+      settled_begins_(max_set_bits_), settled_ends_(max_set_bits_),
+      settled_dirty_(max_set_bits_), settled_events_{~uint64_t(0)},
+      prefetches_{0}, prefetch_cold_misses_{0}, prefetch_hits_(max_set_bits_),
+      useful_begins_(max_set_bits_), useful_ends_(max_set_bits_),
+      distances_(max_set_bits_, 0), mru_line_{~uint64_t(0)}, mru_thread_{0},
+      engine_{engine}, clock_{0} {
         auto lsize = line_size_;
         while(lsize >>= 1) ++log2_line_size_;
     }
     uint64_t getAccesses() const { return accesses_; }
-    vector<unordered_map<uint64_t,uint64_t> > getHits() const { return hits_; }
+    uint64_t getSampledAccesses() const { return sampled_accesses_; }
+    const vector<LogHistogram>& getHits() const { return hits_; }
     uint64_t getColdMisses() const { return cold_misses_; }
     uint64_t getMisalignedMemOps() const { return misaligned_mem_ops_; }
     int getRightMatch(uint64_t a, uint64_t b);
-    vector<unordered_map<uint64_t,uint64_t> > getRemoteHits() const { return remote_hits_; }
+    const vector<LogHistogram>& getRemoteHits() const { return remote_hits_; }
+    uint64_t getStoreAccesses() const { return store_accesses_; }
+    void getWriteTraffic(uint64_t set, uint64_t ways, uint64_t* fills,
+                         uint64_t* writebacks, uint64_t* dirty);
+    uint64_t getPrefetches() const { return prefetches_; }
+    void getPrefetchTraffic(uint64_t set, uint64_t ways,
+                            uint64_t* fills, uint64_t* useful) const;
 
   private:
+    // Find a line and move it to the mru position on behalf of a given
+    // thread, storing its lru stack distance for each set count and the
+    // thread that last accessed it.  Return false on a cold miss.
+    bool linearSearch(uint64_t addr, unsigned thread_id,
+                      vector<uint64_t>& distances, unsigned* last_thread);
+    bool treeSearch(uint64_t addr, unsigned thread_id,
+                    vector<uint64_t>& distances, unsigned* last_thread);
+
     vector<uint64_t> lines_; // back is mru, front is lru
     uint64_t line_size_;
     uint64_t accesses_;
+    uint64_t sampled_accesses_;  // accesses admitted by spatial sampling
     uint64_t misaligned_mem_ops_;  // Number of loads and stores resulting in misaligned cache accesses
     uint64_t log2_line_size_; // log base 2 of line size
     uint64_t max_set_bits_; // log base 2 of max number of sets
     uint64_t cold_misses_;
-    // for each set count, a map of distance to access count
-    vector<unordered_map<uint64_t,uint64_t> > hits_;  // back is lru, front is mru
+    // for each set count, a histogram of distance to access count
+    vector<LogHistogram> hits_;
     bool record_thread_id_;
     // associate thread id with each line in cache. only used if record_thread_id_.
     vector<unsigned> thread_ids_;
-    // for each set count, a map of distance to access count
-    vector<unordered_map<uint64_t,uint64_t> > remote_hits_;  // back is lru, front is mru
+    // for each set count, a histogram of distance to access count
+    vector<LogHistogram> remote_hits_;
+    // The following fields track stores.  A line that has ever been stored
+    // to has an entry in since_store_ giving, for each set count, the
+    // largest lru stack distance of any access since the most recent store,
+    // saturating at the largest value a uint32_t can hold.  The line is
+    // dirty in every cache whose associativity is at least that distance.
+    void updateWriteState(uint64_t addr, bool found,
+                          const vector<uint64_t>& distances, bool is_store);
+    void settleWriteState();
+    void settleLine(const uint32_t* since, const vector<uint64_t>& distances);
+    uint64_t store_accesses_;
+    uint64_t store_cold_misses_;
+    vector<LogHistogram> store_hits_;   // for each set count, lru stack distances of stores
+    FlatAddrMap<uint64_t> store_index_;  // line -> offset into since_store_
+    vector<uint32_t> since_store_;      // max_set_bits_ entries per stored-to line
+    // for each set count, write-backs occur in caches with associativity
+    // from each tally in writeback_begins_ up to but excluding the
+    // corresponding tally in writeback_ends_
+    vector<LogHistogram> writeback_begins_;
+    vector<LogHistogram> writeback_ends_;
+    // for each set count, the write-backs of dirty lines evicted since their
+    // most recent access, in the same form as above, and the associativity
+    // from which each line is still dirty, as of the most recent
+    // settleWriteState()
+    vector<LogHistogram> settled_begins_;
+    vector<LogHistogram> settled_ends_;
+    vector<LogHistogram> settled_dirty_;
+    uint64_t settled_events_;   // sampled accesses plus prefetches when last settled
+    // The following fields track prefetches.  A prefetch moves a line to
+    // the mru position without counting as an access.  A line with a
+    // prefetch pending (i.e., not yet demanded) has an entry in
+    // since_prefetch_ giving, for each set count, the largest lru stack
+    // distance at which it was prefetched, or ~0 if it was prefetched from
+    // memory.  The prefetch brought the line into every cache whose
+    // associativity is less than that distance.
+    void updatePrefetchState(uint64_t addr, bool found,
+                             const vector<uint64_t>& distances, bool is_prefetch);
+    uint64_t prefetches_;
+    uint64_t prefetch_cold_misses_;
+    vector<LogHistogram> prefetch_hits_;  // for each set count, lru stack distances of prefetches
+    FlatAddrMap<uint64_t> prefetch_index_;  // line -> offset into since_prefetch_
+    vector<uint64_t> since_prefetch_;     // max_set_bits_ entries per prefetched line
+    // for each set count, a demanded prefetch was useful in caches with
+    // associativity from each tally in useful_begins_ up to but excluding
+    // the corresponding tally in useful_ends_
+    vector<LogHistogram> useful_begins_;
+    vector<LogHistogram> useful_ends_;
+    vector<uint64_t> distances_;  // scratch space for access()
+    uint64_t mru_line_;     // most recently accessed line
+    unsigned mru_thread_;   // thread that most recently accessed mru_line_
+    CacheEngine engine_;
+    // The remaining fields are used only by the tree engine.
+    struct LineInfo {
+      uint64_t time;    // time of the line's most recent access
+      unsigned thread;  // thread that most recently accessed the line
+    };
+    FlatAddrMap<LineInfo> last_access_;
+    // for each set count, one tree of last-access times per set
+    vector<vector<RDindex> > set_trees_;
+    // for each set count, storage for that set count's trees (one node per
+    // distinct line, so each pool's 32-bit indices cover ~4G lines)
+    vector<RDnodePool> tree_nodes_;
+    uint64_t clock_;
 };
 
 inline int Cache::getRightMatch(uint64_t a, uint64_t b){
@@ -60,57 +159,308 @@ inline int Cache::getRightMatch(uint64_t a, uint64_t b){
   return __builtin_ctzll(diff_bits);
 }
 
-void Cache::access(uint64_t baseaddr, uint64_t numaddrs){
+// Walk the lru stack from the mru end.  This costs time linear in the number
+// of distinct lines ever accessed.
+bool Cache::linearSearch(uint64_t addr, unsigned thread_id,
+                         vector<uint64_t>& distances, unsigned* last_thread){
+  bool found = false;
+  vector<uint64_t> right_match_tally(max_set_bits_, 0);
+  for(int line_idx = lines_.size() - 1; line_idx >= 0; --line_idx){
+    auto& line = lines_[line_idx];
+    int right_match = getRightMatch(addr, line); // returns 0 <= val = max_set_bits_
+    ++right_match_tally[right_match];
+    if(addr == line){
+      found = true;
+      // erase this line.
+      lines_.erase(begin(lines_) + line_idx);
+      if(record_thread_id_){
+        *last_thread = thread_ids_[line_idx];
+        thread_ids_.erase(begin(thread_ids_) + line_idx);
+      }
+      break;
+    }
+  }
+
+  if(found){
+    // rolling sum of right match tally for reuse dists
+    uint64_t sum = 0;
+    for(uint64_t set = max_set_bits_; set-- > 0; ){
+      sum += right_match_tally[set];
+      distances[set] = sum;
+    }
+  }
+
+  // move up this address to mru position
+  lines_.push_back(addr);
+  if(record_thread_id_){
+    thread_ids_.push_back(thread_id);
+  }
+  return found;
+}
+
+// Count, for each set count, the lines in this line's set that were touched
+// since this line's previous access.  This costs time logarithmic in the
+// number of distinct lines ever accessed.
+bool Cache::treeSearch(uint64_t addr, unsigned thread_id,
+                       vector<uint64_t>& distances, unsigned* last_thread){
+  if(set_trees_.empty()){
+    // allocate all of our (initially empty) trees on first use.
+    set_trees_.resize(max_set_bits_);
+    for(uint64_t set = 0; set < max_set_bits_; ++set)
+      set_trees_[set].resize(uint64_t(1) << set, RDnodePool::null_node);
+    tree_nodes_.assign(max_set_bits_,
+                       RDnodePool("Cache-model tree",
+                                  "-bf-sample-period or a larger -bf-line-size"));
+  }
+  uint64_t line_num = addr >> log2_line_size_;
+  auto iter = last_access_.find(addr);
+  bool found = iter != last_access_.end();
+  uint64_t prev_time = 0;
+  if(found){
+    prev_time = iter->second.time;
+    *last_thread = iter->second.thread;
+    iter->second.time = clock_;
+    iter->second.thread = thread_id;
+  } else {
+    last_access_[addr] = LineInfo{clock_, thread_id};
+  }
+
+  for(uint64_t set = 0; set < max_set_bits_; ++set){
+    RDindex& tree = set_trees_[set][line_num & ((uint64_t(1) << set) - 1)];
+    RDnodePool& pool = tree_nodes_[set];
+    RDindex node = RDnodePool::null_node;
+    if(found){
+      distances[set] = pool.tree_dist(tree, prev_time) + 1;
+      tree = pool.remove(tree, prev_time, &node);
+      pool.initialize(node, addr, clock_);
+    } else {
+      node = pool.allocate(addr, clock_);
+    }
+    tree = pool.insert(tree, node);
+  }
+  ++clock_;
+  return found;
+}
+
+// Record write-backs implied by an access to a previously stored-to line,
+// then update the line's write state.  Write-backs are charged when the
+// line is next accessed rather than when it is evicted.
+void Cache::updateWriteState(uint64_t addr, bool found,
+                             const vector<uint64_t>& distances, bool is_store){
+  auto iter = store_index_.find(addr);
+  uint32_t* since = nullptr;
+  if(iter != store_index_.end()){
+    // The line was dirty in caches with at least since[set] ways.  Those
+    // with fewer than distances[set] ways evicted it since its last access.
+    since = &since_store_[iter->second];
+    for(uint64_t set = 0; set < max_set_bits_; ++set){
+      uint64_t first_ways = max(uint64_t(since[set]), uint64_t(1));
+      if(first_ways < distances[set]){
+        writeback_begins_[set].increment(first_ways);
+        writeback_ends_[set].increment(distances[set]);
+      }
+    }
+  }
+
+  if(is_store){
+    ++store_accesses_;
+    if(found)
+      for(uint64_t set = 0; set < max_set_bits_; ++set)
+        store_hits_[set].increment(distances[set]);
+    else
+      ++store_cold_misses_;
+    if(since == nullptr){
+      store_index_[addr] = since_store_.size();
+      since_store_.resize(since_store_.size() + max_set_bits_);
+      since = &since_store_[since_store_.size() - max_set_bits_];
+    }
+    fill(since, since + max_set_bits_, 0);
+  } else if(since != nullptr){
+    for(uint64_t set = 0; set < max_set_bits_; ++set)
+      since[set] = uint32_t(min(max(uint64_t(since[set]), distances[set]),
+                                uint64_t(~uint32_t(0))));
+  }
+}
+
+// Charge the write-back of a stored-to line that, at its current lru stack
+// distance for each set count, has been evicted since its most recent
+// access, and record the associativity from which it is still dirty.
+void Cache::settleLine(const uint32_t* since, const vector<uint64_t>& distances){
+  for(uint64_t set = 0; set < max_set_bits_; ++set){
+    uint64_t first_ways = max(uint64_t(since[set]), uint64_t(1));
+    if(first_ways < distances[set]){
+      settled_begins_[set].increment(first_ways);
+      settled_ends_[set].increment(distances[set]);
+    }
+    settled_dirty_[set].increment(max(first_ways, distances[set]));
+  }
+}
+
+// Find the current lru stack distance of every stored-to line so that lines
+// that were evicted while dirty but never accessed again are charged a
+// write-back.  The result is reused until the cache is next accessed.
+void Cache::settleWriteState(){
+  if(sampled_accesses_ + prefetches_ == settled_events_)
+    return;
+  settled_events_ = sampled_accesses_ + prefetches_;
+  for(uint64_t set = 0; set < max_set_bits_; ++set){
+    settled_begins_[set] = LogHistogram();
+    settled_ends_[set] = LogHistogram();
+    settled_dirty_[set] = LogHistogram();
+  }
+  vector<uint64_t>& distances = distances_;
+  if(engine_ == CACHE_ENGINE_TREE){
+    for(auto& entry: store_index_){
+      uint64_t addr = entry.first;
+      uint64_t line_num = addr >> log2_line_size_;
+      uint64_t time = last_access_.find(addr)->second.time;
+      for(uint64_t set = 0; set < max_set_bits_; ++set){
+        RDindex tree = set_trees_[set][line_num & ((uint64_t(1) << set) - 1)];
+        distances[set] = tree_nodes_[set].tree_dist(tree, time) + 1;
+      }
+      settleLine(&since_store_[entry.second], distances);
+    }
+    return;
+  }
+
+  // Walk the lru stack from the mru end, counting the lines seen in each set.
+  vector<vector<uint64_t> > set_lines(max_set_bits_);
+  for(uint64_t set = 0; set < max_set_bits_; ++set)
+    set_lines[set].resize(uint64_t(1) << set, 0);
+  for(auto line_iter = lines_.rbegin(); line_iter != lines_.rend(); ++line_iter){
+    uint64_t line_num = *line_iter >> log2_line_size_;
+    for(uint64_t set = 0; set < max_set_bits_; ++set)
+      distances[set] = ++set_lines[set][line_num & ((uint64_t(1) << set) - 1)];
+    auto iter = store_index_.find(*line_iter);
+    if(iter != store_index_.end())
+      settleLine(&since_store_[iter->second], distances);
+  }
+}
+
+// Report the number of write-allocate fills and write-backs incurred by a
+// write-back, write-allocate cache with 2^set sets of the given
+// associativity, and the number of lines it still holds dirty.  Write-backs
+// include those of lines evicted but not accessed again; write-backs of the
+// lines still dirty are not included.  Counts are exact only for
+// associativities for which LogHistogram::exact_at() holds.
+void Cache::getWriteTraffic(uint64_t set, uint64_t ways, uint64_t* fills,
+                            uint64_t* writebacks, uint64_t* dirty){
+  settleWriteState();
+  const LogHistogram& store_hits = store_hits_[set];
+  *fills = store_cold_misses_ + store_hits.count_above(ways);
+  *writebacks = writeback_begins_[set].count_at_most(ways)
+    - writeback_ends_[set].count_at_most(ways)
+    + settled_begins_[set].count_at_most(ways)
+    - settled_ends_[set].count_at_most(ways);
+  *dirty = settled_dirty_[set].count_at_most(ways);
+}
+
+// Record a demanded line's pending prefetch as useful, or record a new
+// prefetch of a line.
+void Cache::updatePrefetchState(uint64_t addr, bool found,
+                                const vector<uint64_t>& distances, bool is_prefetch){
+  auto iter = prefetch_index_.find(addr);
+  uint64_t* since = iter == prefetch_index_.end() ? nullptr : &since_prefetch_[iter->second];
+  if(!is_prefetch){
+    // A demand access finds the line in caches with at least distances[set]
+    // ways.  The prefetch was useful in those that it filled.
+    if(since == nullptr || since[0] == 0)
+      return;
+    for(uint64_t set = 0; set < max_set_bits_; ++set){
+      if(distances[set] < since[set]){
+        useful_begins_[set].increment(distances[set]);
+        useful_ends_[set].increment(since[set]);
+      }
+    }
+    fill(since, since + max_set_bits_, 0);
+    return;
+  }
+
+  ++prefetches_;
+  if(found)
+    for(uint64_t set = 0; set < max_set_bits_; ++set)
+      prefetch_hits_[set].increment(distances[set]);
+  else
+    ++prefetch_cold_misses_;
+  if(since == nullptr){
+    prefetch_index_[addr] = since_prefetch_.size();
+    since_prefetch_.resize(since_prefetch_.size() + max_set_bits_, 0);
+    since = &since_prefetch_[since_prefetch_.size() - max_set_bits_];
+  }
+  for(uint64_t set = 0; set < max_set_bits_; ++set)
+    since[set] = max(since[set], found ? distances[set] : ~uint64_t(0));
+}
+
+// Report the number of lines a cache with 2^set sets of the given
+// associativity would fill because of prefetches and how many of those were
+// demanded before being evicted.  As with getWriteTraffic(), counts are exact
+// only for associativities for which LogHistogram::exact_at() holds.
+void Cache::getPrefetchTraffic(uint64_t set, uint64_t ways,
+                               uint64_t* fills, uint64_t* useful) const{
+  *fills = prefetch_cold_misses_ + prefetch_hits_[set].count_above(ways);
+  *useful = useful_begins_[set].count_at_most(ways)
+    - useful_ends_[set].count_at_most(ways);
+}
+
+// Move a line to the mru position without counting an access.
+void Cache::prefetch(uint64_t addr, unsigned thread_id){
+  addr = addr / line_size_ * line_size_;
+  if(!bf_sample_admits(addr >> log2_line_size_))
+    return;
+  if(addr == mru_line_ && thread_id == mru_thread_)
+    return;
+  vector<uint64_t>& distances = distances_;
+  unsigned last_thread = 0;
+  bool found = engine_ == CACHE_ENGINE_TREE
+    ? treeSearch(addr, thread_id, distances, &last_thread)
+    : linearSearch(addr, thread_id, distances, &last_thread);
+  mru_line_ = addr;
+  mru_thread_ = thread_id;
+  updateWriteState(addr, found, distances, false);
+  updatePrefetchState(addr, found, distances, true);
+}
+
+void Cache::access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                   bool is_store){
   uint64_t num_accesses = 0; // running total of number of lines accessed
+  vector<uint64_t>& distances = distances_;
   for(uint64_t addr = baseaddr / line_size_ * line_size_;
       addr <= (baseaddr + numaddrs - 1) / line_size_ * line_size_;
       addr += line_size_){
     ++num_accesses;
-    bool found = false;
+    if(!bf_sample_admits(addr >> log2_line_size_))
+      continue;
+    ++sampled_accesses_;
     unsigned last_thread = 0;
-    vector<uint64_t> right_match_tally(max_set_bits_, 0);
-    for(int line_idx = lines_.size() - 1; line_idx >= 0; --line_idx){
-      auto& line = lines_[line_idx];
-      int right_match = getRightMatch(addr, line); // returns 0 <= val = max_set_bits_
-      ++right_match_tally[right_match];
-      if(addr == line){
-        found = true;
-        // erase this line.
-        lines_.erase(begin(lines_) + line_idx);
-        if(record_thread_id_){
-          last_thread = thread_ids_[line_idx];
-          thread_ids_.erase(begin(thread_ids_) + line_idx);
-        }
-        break;
-      }
+    bool found;
+    if(addr == mru_line_ && thread_id == mru_thread_){
+      // Reaccessing the mru line is a hit at distance 1 for every set count
+      // and leaves the lru stack unchanged, so skip the search.
+      found = true;
+      last_thread = thread_id;
+      fill(begin(distances), end(distances), 1);
+    } else {
+      found = engine_ == CACHE_ENGINE_TREE
+        ? treeSearch(addr, thread_id, distances, &last_thread)
+        : linearSearch(addr, thread_id, distances, &last_thread);
+      mru_line_ = addr;
+      mru_thread_ = thread_id;
     }
 
     if(found){
-      // rolling sum of right match tally for reuse dists
-      uint64_t sum = 0;
-      for(auto tally = right_match_tally.rbegin();
-          tally != right_match_tally.rend();
-          ++tally){
-        *tally += sum;
-        sum = *tally;
-      }
       for(uint64_t set = 0; set < max_set_bits_; ++set){
-        auto idx = right_match_tally[set];
-        ++hits_[set][idx];
+        hits_[set].increment(distances[set]);
         if(record_thread_id_ &&
-           last_thread != cache_id){
-          ++remote_hits_[set][idx];
+           last_thread != thread_id){
+          remote_hits_[set].increment(distances[set]);
         }
       }
     } else {
       ++cold_misses_;
     }
-
-    // move up this address to mru position
-    lines_.push_back(addr);
-    if(record_thread_id_){
-      thread_ids_.push_back(cache_id);
-    }
+    updateWriteState(addr, found, distances, is_store);
+    if(prefetches_ > 0)
+      updatePrefetchState(addr, found, distances, false);
   }
 
   // we've made all our accesses
@@ -120,6 +470,467 @@ void Cache::access(uint64_t baseaddr, uint64_t numaddrs){
     ++misaligned_mem_ops_;
 }
 
+// Define the ways a level of a cache hierarchy can relate to the levels
+// nearer the processor.
+enum CacheInclusion {
+  CACHE_NINE,        // Neither inclusive nor exclusive
+  CACHE_INCLUSIVE,   // Evicting a line evicts it from all nearer levels
+  CACHE_EXCLUSIVE    // Filled only by lines evicted from the next-nearer level
+};
+
+// Describe one level of a cache hierarchy.
+struct CacheLevelSpec {
+  uint64_t size;             // Capacity in bytes
+  uint64_t ways;             // Associativity
+  uint64_t sets;             // Number of sets
+  bool shared;               // true=one instance for all threads; false=one per thread
+  CacheInclusion inclusion;  // Relationship to nearer levels
+};
+
+// A CacheLevel is a single set-associative cache with LRU replacement.  It
+// records only which lines are present and whether they are dirty, not
+// their contents.
+class CacheLevel {
+  public:
+    CacheLevel(uint64_t sets, uint64_t ways) :
+      sets_{sets}, ways_{ways}, lines_(sets*ways, invalid_line),
+      stamps_(sets*ways, 0), dirty_(sets*ways, false), clock_{0} { }
+
+    // Make a line the most recently used if it's present.  Return true on
+    // a hit.
+    bool lookup(uint64_t line);
+
+    // Bring a line into the cache.  Return true and the evicted line and its
+    // dirty bit if a valid line had to be replaced.
+    bool insert(uint64_t line, bool dirty, uint64_t* victim, bool* victim_dirty);
+
+    // Remove a line from the cache.  Return true and the line's dirty bit if
+    // it was present.
+    bool remove(uint64_t line, bool* dirty);
+
+    // Mark a line as dirty.  Return true if it was present.
+    bool markDirty(uint64_t line);
+
+  private:
+    static const uint64_t invalid_line = ~uint64_t(0);
+    uint64_t* find(uint64_t line);
+    uint64_t sets_;
+    uint64_t ways_;
+    vector<uint64_t> lines_;   // sets_ groups of ways_ line numbers
+    vector<uint64_t> stamps_;  // time of each way's most recent access
+    vector<bool> dirty_;       // whether each way has been written
+    uint64_t clock_;
+};
+
+const uint64_t CacheLevel::invalid_line;
+
+inline uint64_t* CacheLevel::find(uint64_t line){
+  uint64_t first = line % sets_ * ways_;
+  for(uint64_t way = first; way < first + ways_; ++way){
+    if(lines_[way] == line)
+      return &lines_[way];
+  }
+  return nullptr;
+}
+
+bool CacheLevel::lookup(uint64_t line){
+  uint64_t* way = find(line);
+  if(way == nullptr)
+    return false;
+  stamps_[way - lines_.data()] = ++clock_;
+  return true;
+}
+
+bool CacheLevel::insert(uint64_t line, bool dirty, uint64_t* victim, bool* victim_dirty){
+  if(lookup(line)){
+    if(dirty)
+      markDirty(line);
+    return false;
+  }
+
+  // Replace an invalid way if there is one, otherwise the lru way.
+  uint64_t first = line % sets_ * ways_;
+  uint64_t lru = first;
+  for(uint64_t way = first; way < first + ways_; ++way){
+    if(lines_[way] == invalid_line){
+      lru = way;
+      break;
+    }
+    if(stamps_[way] < stamps_[lru])
+      lru = way;
+  }
+  bool evicted = lines_[lru] != invalid_line;
+  *victim = lines_[lru];
+  *victim_dirty = dirty_[lru];
+  lines_[lru] = line;
+  stamps_[lru] = ++clock_;
+  dirty_[lru] = dirty;
+  return evicted;
+}
+
+bool CacheLevel::remove(uint64_t line, bool* dirty){
+  uint64_t* way = find(line);
+  if(way == nullptr)
+    return false;
+  size_t idx = way - lines_.data();
+  *way = invalid_line;
+  stamps_[idx] = 0;
+  *dirty = dirty_[idx];
+  dirty_[idx] = false;
+  return true;
+}
+
+bool CacheLevel::markDirty(uint64_t line){
+  uint64_t* way = find(line);
+  if(way == nullptr)
+    return false;
+  dirty_[way - lines_.data()] = true;
+  return true;
+}
+
+// A CacheHierarchy models a multi-level, write-back, write-allocate cache
+// hierarchy.  Private levels are instantiated per thread, and shared levels
+// are instantiated once.  Stores dirty only the nearest level; a dirty
+// line's eviction writes it back to the nearest farther level that holds
+// the line (or that is exclusive) or else to memory.
+// When spatially sampling, each level is shrunk by the sample period (by
+// reducing its number of sets) and sees only the sampled lines.  Callers
+// must serialize calls to access().
+class CacheHierarchy {
+  public:
+    CacheHierarchy(uint64_t line_size, const vector<CacheLevelSpec>& specs) :
+      line_size_{line_size}, specs_(specs), hits_(specs.size(), 0),
+      misses_(specs.size(), 0), back_invalidations_(specs.size(), 0),
+      store_misses_(specs.size(), 0), writebacks_(specs.size(), 0),
+      memory_writebacks_{0} {
+        for(auto& spec: specs_)
+          shared_levels_.push_back(spec.shared ? new CacheLevel(sampledSets(spec), spec.ways) : nullptr);
+    }
+    void access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                bool is_store);
+    const vector<CacheLevelSpec>& getSpecs() const { return specs_; }
+    const vector<uint64_t>& getHits() const { return hits_; }
+    const vector<uint64_t>& getMisses() const { return misses_; }
+    const vector<uint64_t>& getBackInvalidations() const { return back_invalidations_; }
+    const vector<uint64_t>& getStoreMisses() const { return store_misses_; }
+    const vector<uint64_t>& getWritebacks() const { return writebacks_; }
+    uint64_t getMemoryWritebacks() const { return memory_writebacks_; }
+
+  private:
+    vector<CacheLevel*>& levelsFor(unsigned thread_id);
+    static uint64_t sampledSets(const CacheLevelSpec& spec) {
+      return max(spec.sets/bf_sample_period, uint64_t(1));
+    }
+    void accessLine(uint64_t line, unsigned thread_id, bool is_store);
+    void evicted(size_t idx, uint64_t line, bool dirty, unsigned thread_id);
+    void invalidateNearer(size_t idx, uint64_t line, unsigned thread_id,
+                          bool* dirty);
+
+    uint64_t line_size_;
+    vector<CacheLevelSpec> specs_;     // one per level, nearest first
+    vector<CacheLevel*> shared_levels_;  // nullptr for private levels
+    vector<vector<CacheLevel*> > thread_levels_;  // every level as seen by each thread
+    vector<uint64_t> hits_;            // hits per level, summed across threads
+    vector<uint64_t> misses_;          // misses per level, summed across threads
+    vector<uint64_t> back_invalidations_;  // inclusion-induced evictions per level
+    vector<uint64_t> store_misses_;    // write-allocate fills per level
+    vector<uint64_t> writebacks_;      // dirty evictions per level
+    uint64_t memory_writebacks_;       // dirty lines written back to memory
+};
+
+// Return a thread's view of the hierarchy, creating its private levels on
+// first use.
+vector<CacheLevel*>& CacheHierarchy::levelsFor(unsigned thread_id){
+  while(thread_levels_.size() <= thread_id){
+    vector<CacheLevel*> levels;
+    for(size_t i = 0; i < specs_.size(); ++i)
+      levels.push_back(specs_[i].shared
+                       ? shared_levels_[i]
+                       : new CacheLevel(sampledSets(specs_[i]), specs_[i].ways));
+    thread_levels_.push_back(levels);
+  }
+  return thread_levels_[thread_id];
+}
+
+// Remove a line from every level nearer than a given inclusive level,
+// accumulating whether any removed copy was dirty.
+void CacheHierarchy::invalidateNearer(size_t idx, uint64_t line, unsigned thread_id,
+                                      bool* dirty){
+  bool was_dirty;
+  for(size_t i = 0; i < idx; ++i){
+    if(specs_[i].shared){
+      if(shared_levels_[i]->remove(line, &was_dirty)){
+        ++back_invalidations_[i];
+        *dirty |= was_dirty;
+      }
+    } else if(specs_[idx].shared){
+      // A shared level's inclusion covers every thread's private levels.
+      for(auto& levels: thread_levels_)
+        if(levels[i]->remove(line, &was_dirty)){
+          ++back_invalidations_[i];
+          *dirty |= was_dirty;
+        }
+    } else if(thread_levels_[thread_id][i]->remove(line, &was_dirty)){
+      ++back_invalidations_[i];
+      *dirty |= was_dirty;
+    }
+  }
+}
+
+// Enforce the inclusion and write-back policies affected by a line's
+// eviction from a given level.
+void CacheHierarchy::evicted(size_t idx, uint64_t line, bool dirty, unsigned thread_id){
+  if(specs_[idx].inclusion == CACHE_INCLUSIVE)
+    invalidateNearer(idx, line, thread_id, &dirty);
+  if(dirty)
+    ++writebacks_[idx];
+  vector<CacheLevel*>& levels = thread_levels_[thread_id];
+  if(idx + 1 < specs_.size() && specs_[idx + 1].inclusion == CACHE_EXCLUSIVE){
+    uint64_t victim;
+    bool victim_dirty;
+    if(levels[idx + 1]->insert(line, dirty, &victim, &victim_dirty))
+      evicted(idx + 1, victim, victim_dirty, thread_id);
+    return;
+  }
+  if(!dirty)
+    return;
+  for(size_t i = idx + 1; i < specs_.size(); ++i)
+    if(levels[i]->markDirty(line))
+      return;
+  ++memory_writebacks_;
+}
+
+void CacheHierarchy::accessLine(uint64_t line, unsigned thread_id, bool is_store){
+  vector<CacheLevel*>& levels = levelsFor(thread_id);
+  size_t num_levels = specs_.size();
+  size_t hit_level = num_levels;
+  for(size_t i = 0; i < num_levels; ++i){
+    if(levels[i]->lookup(line)){
+      ++hits_[i];
+      hit_level = i;
+      break;
+    }
+    ++misses_[i];
+    if(is_store)
+      ++store_misses_[i];
+  }
+
+  // An exclusive level gives up the line (and its dirty data) to the
+  // nearer levels.
+  bool dirty = is_store;
+  if(hit_level < num_levels && specs_[hit_level].inclusion == CACHE_EXCLUSIVE){
+    bool was_dirty;
+    levels[hit_level]->remove(line, &was_dirty);
+    dirty |= was_dirty;
+  }
+
+  // Fill the levels that missed, farthest first so that back-invalidations
+  // triggered by an inclusive level precede filling the nearer levels.
+  // Exclusive levels are filled only by evictions.
+  for(size_t i = hit_level; i-- > 0; ){
+    if(specs_[i].inclusion == CACHE_EXCLUSIVE)
+      continue;
+    uint64_t victim;
+    bool victim_dirty;
+    if(levels[i]->insert(line, false, &victim, &victim_dirty))
+      evicted(i, victim, victim_dirty, thread_id);
+  }
+  if(dirty)
+    levels[0]->markDirty(line);
+}
+
+void CacheHierarchy::access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                            bool is_store){
+  for(uint64_t line = baseaddr / line_size_;
+      line <= (baseaddr + numaddrs - 1) / line_size_;
+      ++line)
+    if(bf_sample_admits(line))
+      accessLine(line, thread_id, is_store);
+}
+
+// A SharingDetector watches stores to each cache line for changes of writer,
+// each of which would force a write-invalidate protocol to transfer the
+// line between cores.  A transfer is classified as true sharing if the new
+// writer stores to any byte the previous writer stored to since taking the
+// line and as false sharing otherwise.
+class SharingDetector {
+  public:
+    SharingDetector(uint64_t line_size) :
+      line_size_{line_size}, words_per_line_{(line_size + 63) / 64},
+      stored_(words_per_line_, 0),
+      description_ids_{{"", 0}}, descriptions_{""} { }
+    void access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                bool is_store);
+
+    // Per-line sharing information, exposed for reporting
+    struct LineState {
+      unsigned owner;            // thread that most recently stored to the line
+      uint32_t description;      // index into descriptions_ of the line's data structure
+      uint64_t mask_offset;      // offset into masks_ of the owner's stored-to bytes
+      uint64_t writers;          // bit mask of threads (mod 64) that stored to the line
+      uint64_t false_transfers;  // writer changes with disjoint bytes
+      uint64_t true_transfers;   // writer changes with overlapping bytes
+    };
+    const FlatAddrMap<LineState>& getLines() const { return lines_; }
+    const string& getDescription(uint32_t idx) const { return descriptions_[idx]; }
+
+  private:
+    void storeLine(uint64_t line, uint64_t first_byte, uint64_t last_byte,
+                   unsigned thread_id);
+    uint64_t line_size_;
+    uint64_t words_per_line_;     // 64-bit words per byte mask
+    FlatAddrMap<LineState> lines_;  // only lines ever stored to
+    vector<uint64_t> masks_;      // words_per_line_ words per line
+    vector<uint64_t> stored_;     // scratch mask of the bytes being stored
+    unordered_map<string, uint32_t> description_ids_;  // interned data-structure descriptions
+    vector<string> descriptions_;
+};
+
+// Record a store to bytes first_byte through last_byte (offsets within the
+// line) of a given line.
+void SharingDetector::storeLine(uint64_t line, uint64_t first_byte, uint64_t last_byte,
+                                unsigned thread_id){
+  auto iter = lines_.find(line);
+  if(iter == lines_.end()){
+    lines_[line] = LineState{thread_id, 0, masks_.size(), 0, 0, 0};
+    masks_.resize(masks_.size() + words_per_line_, 0);
+    iter = lines_.find(line);
+  }
+  LineState& state = iter->second;
+  uint64_t* mask = &masks_[state.mask_offset];
+  state.writers |= uint64_t(1) << (thread_id % 64);
+
+  // Build a mask of the bytes being stored a word at a time.
+  uint64_t* stored = stored_.data();
+  fill(stored, stored + words_per_line_, 0);
+  for(uint64_t word = first_byte / 64; word <= last_byte / 64; ++word){
+    uint64_t lo = word == first_byte / 64 ? first_byte % 64 : 0;
+    uint64_t hi = word == last_byte / 64 ? last_byte % 64 : 63;
+    stored[word] = (~uint64_t(0) >> (63 - hi)) & (~uint64_t(0) << lo);
+  }
+
+  if(thread_id != state.owner){
+    // Another thread owns the line.  Classify the transfer, and attribute
+    // the line to a data structure the first time it's transferred.
+    bool overlap = false;
+    for(uint64_t word = 0; word < words_per_line_; ++word)
+      overlap |= (mask[word] & stored[word]) != 0;
+    if(overlap)
+      ++state.true_transfers;
+    else
+      ++state.false_transfers;
+    if(state.false_transfers + state.true_transfers == 1 && bf_data_structs){
+      string desc(bf_describe_data_struct(line*line_size_ + first_byte));
+      auto desc_iter = description_ids_.find(desc);
+      if(desc_iter == description_ids_.end()){
+        desc_iter = description_ids_.emplace(desc, uint32_t(descriptions_.size())).first;
+        descriptions_.push_back(desc);
+      }
+      state.description = desc_iter->second;
+    }
+    state.owner = thread_id;
+    fill(mask, mask + words_per_line_, 0);
+  }
+  for(uint64_t word = 0; word < words_per_line_; ++word)
+    mask[word] |= stored[word];
+}
+
+void SharingDetector::access(uint64_t baseaddr, uint64_t numaddrs, unsigned thread_id,
+                             bool is_store){
+  if(!is_store || numaddrs == 0)
+    return;
+  uint64_t lastaddr = baseaddr + numaddrs - 1;
+  for(uint64_t line = baseaddr / line_size_; line <= lastaddr / line_size_; ++line){
+    if(!bf_sample_admits(line))
+      continue;
+    uint64_t line_start = line*line_size_;
+    uint64_t first_byte = max(baseaddr, line_start) - line_start;
+    uint64_t last_byte = min(lastaddr, line_start + line_size_ - 1) - line_start;
+    storeLine(line, first_byte, last_byte, thread_id);
+  }
+}
+
+// A CacheQueue carries one application thread's accesses to the shared
+// cache model.  It is a single-producer, single-consumer queue built from
+// fixed-size blocks: the producer only ever appends and the consumer only
+// ever removes, so the producer never takes a lock, and it simply links in a
+// new block instead of waiting when the consumer falls behind.
+class CacheQueue {
+  public:
+    CacheQueue(unsigned thread_id) : thread_id_{thread_id} {
+      head_ = tail_ = new Block();
+      head_pos_ = 0;
+    }
+    void push(uint64_t baseaddr, uint64_t numaddrs, bool is_store,
+              bool is_prefetch=false);
+    uint64_t drain(Cache* target, CacheHierarchy* hierarchy, SharingDetector* sharing);
+
+  private:
+    struct Entry {
+      uint64_t baseaddr;
+      uint64_t numaddrs;
+      bool is_store;
+      bool is_prefetch;
+    };
+    struct Block {
+      static const size_t capacity = 4096;
+      Entry entries[capacity];
+      atomic<size_t> count;   // number of entries the producer has published
+      atomic<Block*> next;    // next block, once this one is full
+      Block() : count{0}, next{nullptr} { }
+    };
+    unsigned thread_id_;  // cache_id of the producing thread
+    Block* head_;         // block the consumer is reading (consumer only)
+    size_t head_pos_;     // next entry the consumer will read (consumer only)
+    Block* tail_;         // block the producer is writing (producer only)
+};
+
+// Append an access to the queue.  Called only by the owning thread.
+void CacheQueue::push(uint64_t baseaddr, uint64_t numaddrs, bool is_store,
+                      bool is_prefetch){
+  size_t pos = tail_->count.load(memory_order_relaxed);
+  if(pos == Block::capacity){
+    Block* block = new Block();
+    tail_->next.store(block, memory_order_release);
+    tail_ = block;
+    pos = 0;
+  }
+  tail_->entries[pos] = Entry{baseaddr, numaddrs, is_store, is_prefetch};
+  tail_->count.store(pos + 1, memory_order_release);
+}
+
+// Feed all published accesses into a cache and, if non-null, a cache
+// hierarchy and a sharing detector, tagged with the producing thread, and
+// return the number of accesses consumed.  Prefetches are fed only into the
+// cache.  Calls must be serialized by global_cache_mutex.
+uint64_t CacheQueue::drain(Cache* target, CacheHierarchy* hierarchy, SharingDetector* sharing){
+  uint64_t consumed = 0;
+  while(true){
+    size_t count = head_->count.load(memory_order_acquire);
+    for(; head_pos_ < count; ++head_pos_, ++consumed){
+      const auto& entry = head_->entries[head_pos_];
+      if(entry.is_prefetch){
+        target->prefetch(entry.baseaddr, thread_id_);
+        continue;
+      }
+      target->access(entry.baseaddr, entry.numaddrs, thread_id_, entry.is_store);
+      if(hierarchy != nullptr)
+        hierarchy->access(entry.baseaddr, entry.numaddrs, thread_id_, entry.is_store);
+      if(sharing != nullptr)
+        sharing->access(entry.baseaddr, entry.numaddrs, thread_id_, entry.is_store);
+    }
+    if(head_pos_ < Block::capacity)
+      break;
+    Block* next = head_->next.load(memory_order_acquire);
+    if(next == nullptr)
+      break;
+    delete head_;
+    head_ = next;
+    head_pos_ = 0;
+  }
+  return consumed;
+}
+
 namespace bytesflops{
 
 static __thread Cache* cache = nullptr;
@@ -127,26 +938,343 @@ static vector<Cache*>* caches = nullptr;
 static Cache* global_cache = nullptr;
 static mutex cache_vector_mutex, global_cache_mutex;
 static unsigned thread_counter = 0;
+static CacheEngine cache_engine = CACHE_ENGINE_TREE;
+static CacheHierarchy* cache_hierarchy = nullptr;  // updated along with global_cache
+static SharingDetector* sharing_detector = nullptr;  // updated along with global_cache
+
+// The following are used only when the shared cache is fed asynchronously.
+static bool use_cache_queues = false;
+static __thread CacheQueue* cache_queue = nullptr;
+static vector<CacheQueue*>* cache_queues = nullptr;  // protected by cache_vector_mutex
+static thread* cache_consumer = nullptr;  // protected by cache_vector_mutex
+static atomic<bool> stop_cache_consumer{false};
+static atomic<bool> cache_queues_finished{false};  // true=model accesses directly
+
+// The following are used only when emulating hardware prefetchers.
+static bool prefetch_next_line = false;  // prefetch the next line on each new line accessed
+static bool prefetch_strides = false;    // prefetch one stride ahead of each steady call point
+static __thread uint64_t prev_line = ~uint64_t(0);  // last line this thread accessed
+
+// The following are used only when modeling TLBs.  Each TLB is a Cache
+// whose "lines" are pages.  TLBs are modeled per thread, one per page size.
+static const uint64_t tlb_max_set_bits = 8;      // log2 of max number of TLB sets to model
+static vector<uint64_t>* tlb_page_sizes = nullptr;  // page sizes to model, if any
+static __thread vector<Cache*>* tlbs = nullptr;  // this thread's TLBs
+static vector<vector<Cache*>*>* all_tlbs = nullptr;  // protected by cache_vector_mutex
+
+// Return true if accesses to the shared cache should be queued for the
+// consumer thread instead of modeled directly.
+static inline bool queueing_accesses(void){
+  return use_cache_queues && !cache_queues_finished.load(memory_order_acquire);
+}
+
+// Drain every thread's queue into the shared cache until told to stop, then
+// drain whatever remains.  The consumer holds global_cache_mutex while
+// draining so that it never overlaps a thread that models its accesses
+// directly.
+static void consume_cache_queues(void){
+  vector<CacheQueue*> queues;
+  bool stopping;
+  do {
+    stopping = stop_cache_consumer.load(memory_order_acquire);
+    {
+      lock_guard<mutex> guard(cache_vector_mutex);
+      queues = *cache_queues;
+    }
+    uint64_t consumed = 0;
+    {
+      lock_guard<mutex> guard(global_cache_mutex);
+      for(auto& queue: queues){
+        consumed += queue->drain(global_cache, cache_hierarchy, sharing_detector);
+      }
+    }
+    if(consumed == 0 && !stopping){
+      this_thread::sleep_for(chrono::microseconds(100));
+    }
+  } while(!stopping);
+}
+
+// Stop the consumer thread after it has modeled every queued access, and
+// make all later accesses bypass the queues.  Because a thread may queue an
+// access just as the consumer stops, every call also drains the queues
+// synchronously.
+static void finish_cache_queues(void){
+  if(!use_cache_queues)
+    return;
+  thread* consumer;
+  vector<CacheQueue*> queues;
+  {
+    lock_guard<mutex> guard(cache_vector_mutex);
+    cache_queues_finished.store(true, memory_order_release);
+    consumer = cache_consumer;
+    cache_consumer = nullptr;
+    queues = *cache_queues;
+  }
+  if(consumer != nullptr){
+    stop_cache_consumer.store(true, memory_order_release);
+    consumer->join();
+    delete consumer;
+  }
+  lock_guard<mutex> guard(global_cache_mutex);
+  for(auto& queue: queues){
+    queue->drain(global_cache, cache_hierarchy, sharing_detector);
+  }
+}
+
+// Parse a size in bytes, which may end in K, M, or G.
+uint64_t bf_parse_size(const char* size_str, char** end){
+  uint64_t size = strtoull(size_str, end, 10);
+  switch(**end){
+    case 'K': case 'k': size <<= 10; ++*end; break;
+    case 'M': case 'm': size <<= 20; ++*end; break;
+    case 'G': case 'g': size <<= 30; ++*end; break;
+    default: break;
+  }
+  return size;
+}
+
+// Parse a comma-separated list of page sizes.  Abort on error.
+static vector<uint64_t> parse_page_sizes(const char* description){
+  vector<uint64_t> sizes;
+  const char* size_str = description;
+  while(true){
+    char* end;
+    uint64_t size = bf_parse_size(size_str, &end);
+    if(size == 0 || (size & (size - 1)) != 0 || (*end != ',' && *end != '\0')){
+      cerr << "Failed to parse BF_TLB_PAGE_SIZES (\"" << description
+           << "\"): page sizes must be powers of two\n";
+      bf_abend();
+    }
+    sizes.push_back(size);
+    if(*end == '\0')
+      break;
+    size_str = end + 1;
+  }
+  return sizes;
+}
+
+// Parse a cache-hierarchy description of the form
+// "<size>:<ways>[:<option>...],..." with the level nearest the processor
+// listed first.  Sizes may end in K, M, or G.  Options are "shared",
+// "inclusive", and "exclusive".  Abort on error.
+static vector<CacheLevelSpec> parse_cache_hierarchy(const char* description){
+  vector<CacheLevelSpec> specs;
+  const char* errmsg = nullptr;
+  string desc(description);
+  size_t start = 0;
+  while(errmsg == nullptr && start <= desc.size()){
+    size_t end = desc.find(',', start);
+    if(end == string::npos)
+      end = desc.size();
+    string level_str(desc, start, end - start);
+    start = end + 1;
+
+    // Parse the size and associativity.
+    CacheLevelSpec spec = {0, 0, 0, false, CACHE_NINE};
+    char* suffix;
+    spec.size = bf_parse_size(level_str.c_str(), &suffix);
+    if(*suffix != ':'){
+      errmsg = "expected \"<size>:<ways>\"";
+      break;
+    }
+    spec.ways = strtoull(suffix + 1, &suffix, 10);
+    if(spec.size == 0 || spec.ways == 0){
+      errmsg = "sizes and associativities must be positive";
+      break;
+    }
+    if(spec.size % (bf_line_size*spec.ways) != 0){
+      errmsg = "each size must be a multiple of the line size times the associativity";
+      break;
+    }
+    spec.sets = spec.size/(bf_line_size*spec.ways);
+
+    // Parse the options.
+    while(errmsg == nullptr && *suffix == ':'){
+      const char* option = suffix + 1;
+      size_t len = strcspn(option, ":");
+      suffix += len + 1;
+      if(len == 6 && strncmp(option, "shared", len) == 0)
+        spec.shared = true;
+      else if(len == 9 && strncmp(option, "inclusive", len) == 0)
+        spec.inclusion = CACHE_INCLUSIVE;
+      else if(len == 9 && strncmp(option, "exclusive", len) == 0)
+        spec.inclusion = CACHE_EXCLUSIVE;
+      else
+        errmsg = "options must be \"shared\", \"inclusive\", or \"exclusive\"";
+    }
+    if(errmsg != nullptr)
+      break;
+    if(*suffix != '\0')
+      errmsg = "unexpected text after a level description";
+    else if(specs.empty() && spec.inclusion == CACHE_EXCLUSIVE)
+      errmsg = "the first level cannot be exclusive";
+    else if(!specs.empty() && specs.back().shared && !spec.shared)
+      errmsg = "a private level cannot follow a shared level";
+    specs.push_back(spec);
+  }
+  if(errmsg != nullptr){
+    cerr << "Failed to parse BF_CACHE_HIERARCHY (\"" << description << "\"): "
+         << errmsg << '\n';
+    bf_abend();
+  }
+  return specs;
+}
 
 void initialize_cache(void){
   if(caches == nullptr){
     caches = new vector<Cache*>();
   }
-  global_cache = new Cache(bf_line_size, bf_max_set_bits, true);
+
+  // Let the user select the LRU stack-distance engine at run time, for
+  // example to cross-check the tree engine against the linear engine.
+  const char* engine_name = getenv("BF_CACHE_ENGINE");
+  if(engine_name != nullptr){
+    if(strcmp(engine_name, "linear") == 0)
+      cache_engine = CACHE_ENGINE_LINEAR;
+    else if(strcmp(engine_name, "tree") == 0)
+      cache_engine = CACHE_ENGINE_TREE;
+    else {
+      cerr << "BF_CACHE_ENGINE must be either \"linear\" or \"tree\"\n";
+      bf_abend();
+    }
+  }
+  global_cache = new Cache(bf_line_size, bf_max_set_bits, true, cache_engine);
+
+  // Let the user decouple application threads from the shared cache model.
+  // Each thread queues its accesses, and a separate consumer thread models
+  // them.  The shared cache then sees each thread's accesses in order, but
+  // accesses from different threads are interleaved in drain order rather
+  // than in exact execution order.
+  const char* use_queues = getenv("BF_CACHE_QUEUE");
+  if(use_queues != nullptr && strcmp(use_queues, "") != 0 && strcmp(use_queues, "0") != 0){
+    use_cache_queues = true;
+    cache_queues = new vector<CacheQueue*>();
+  }
+
+  // Let the user additionally model a concrete cache hierarchy.
+  const char* hierarchy = getenv("BF_CACHE_HIERARCHY");
+  if(hierarchy != nullptr && strcmp(hierarchy, "") != 0)
+    cache_hierarchy = new CacheHierarchy(bf_line_size, parse_cache_hierarchy(hierarchy));
+
+  // Let the user detect false and true sharing of cache lines among threads.
+  const char* sharing = getenv("BF_CACHE_SHARING");
+  if(sharing != nullptr && strcmp(sharing, "") != 0 && strcmp(sharing, "0") != 0)
+    sharing_detector = new SharingDetector(bf_line_size);
+
+  // Let the user emulate a next-line prefetcher, a per-call-point stride
+  // prefetcher, or both.
+  const char* prefetchers = getenv("BF_CACHE_PREFETCH");
+  if(prefetchers != nullptr){
+    string prefetch_list(prefetchers);
+    size_t start = 0;
+    while(start <= prefetch_list.size()){
+      size_t comma = prefetch_list.find(',', start);
+      if(comma == string::npos)
+        comma = prefetch_list.size();
+      string name(prefetch_list.substr(start, comma - start));
+      if(name == "next-line")
+        prefetch_next_line = true;
+      else if(name == "stride")
+        prefetch_strides = true;
+      else if(name != "" && name != "none"){
+        cerr << "BF_CACHE_PREFETCH must be a comma-separated list of \"next-line\" and \"stride\"\n";
+        bf_abend();
+      }
+      start = comma + 1;
+    }
+    if(prefetch_strides && !bf_strides){
+      cerr << "BF_CACHE_PREFETCH=stride requires a program built with -bf-strides\n";
+      bf_abend();
+    }
+  }
+
+  // Let the user additionally model TLBs for one or more page sizes.
+  const char* page_sizes = getenv("BF_TLB_PAGE_SIZES");
+  if(page_sizes != nullptr && strcmp(page_sizes, "") != 0){
+    tlb_page_sizes = new vector<uint64_t>(parse_page_sizes(page_sizes));
+    all_tlbs = new vector<vector<Cache*>*>();
+  }
+}
+
+// Prefetch the line containing a given address into this thread's cache and
+// the shared cache.
+static void prefetch_line(uint64_t addr){
+  cache->prefetch(addr, cache_id);
+  if(queueing_accesses()){
+    cache_queue->push(addr, 0, false, true);
+    return;
+  }
+  lock_guard<mutex> guard(global_cache_mutex);
+  if(cache_queue != nullptr)
+    cache_queue->drain(global_cache, cache_hierarchy, sharing_detector);
+  global_cache->prefetch(addr, cache_id);
 }
 
-// Access the cache model with this address.
-void bf_touch_cache(uint64_t baseaddr, uint64_t numaddrs){
+// Prefetch one stride ahead of an access made by a call point whose stride
+// is steady.
+void bf_prefetch_stride(uint64_t addr, int64_t stride){
+  if(!prefetch_strides || cache == nullptr)
+    return;
+  uint64_t target = addr + uint64_t(stride);
+  if(target / bf_line_size != addr / bf_line_size)
+    prefetch_line(target);
+}
+
+// Access the cache model with this address.  load0store1 is 0 for a load
+// and 1 for a store.
+void bf_touch_cache(uint64_t baseaddr, uint64_t numaddrs, uint8_t load0store1){
+  if(numaddrs == 0)
+    return;
+  bool is_store = load0store1 != 0;
   if(cache == nullptr){
     // Only let one thread update caches at a time.
     lock_guard<mutex> guard(cache_vector_mutex);
-    cache = new Cache(bf_line_size, bf_max_set_bits, false);
+    cache = new Cache(bf_line_size, bf_max_set_bits, false, cache_engine);
     caches->push_back(cache);
     cache_id = thread_counter++;
+    if(tlb_page_sizes != nullptr){
+      tlbs = new vector<Cache*>();
+      for(auto& page_size: *tlb_page_sizes)
+        tlbs->push_back(new Cache(page_size, min(bf_max_set_bits, tlb_max_set_bits),
+                                  false, cache_engine));
+      all_tlbs->push_back(tlbs);
+    }
+    if(queueing_accesses()){
+      // Start the consumer on first use but never once the queues have
+      // been finished, as no one would join it.
+      cache_queue = new CacheQueue(cache_id);
+      cache_queues->push_back(cache_queue);
+      if(cache_consumer == nullptr)
+        cache_consumer = new thread(consume_cache_queues);
+    }
+  }
+  cache->access(baseaddr, numaddrs, cache_id, is_store);
+  if(tlbs != nullptr)
+    for(auto& tlb: *tlbs)
+      tlb->access(baseaddr, numaddrs, cache_id, is_store);
+  if(queueing_accesses()){
+    cache_queue->push(baseaddr, numaddrs, is_store);
+  } else {
+    // Model directly, after any of this thread's accesses that are still
+    // queued from before the queues were finished.
+    lock_guard<mutex> guard(global_cache_mutex);
+    if(cache_queue != nullptr)
+      cache_queue->drain(global_cache, cache_hierarchy, sharing_detector);
+    global_cache->access(baseaddr, numaddrs, cache_id, is_store);
+    if(cache_hierarchy != nullptr)
+      cache_hierarchy->access(baseaddr, numaddrs, cache_id, is_store);
+    if(sharing_detector != nullptr)
+      sharing_detector->access(baseaddr, numaddrs, cache_id, is_store);
+  }
+
+  // On moving to a new line, prefetch the line after it.
+  if(prefetch_next_line){
+    uint64_t last_line = (baseaddr + numaddrs - 1) / bf_line_size;
+    if(last_line != prev_line){
+      prev_line = last_line;
+      prefetch_line((last_line + 1) * bf_line_size);
+    }
   }
-  cache->access(baseaddr, numaddrs);
-  lock_guard<mutex> guard(global_cache_mutex);
-  global_cache->access(baseaddr, numaddrs);
 }
 
 // Get cache accesses
@@ -166,40 +1294,44 @@ vector<T> vecsum(const vector<T>& a, const vector<T>& b){
   return out;
 }
 
-template<typename T>
-T mapsum(const T& a, const T& b){
-  T out(a);
-  for(const auto& elem : b){
-    out[elem.first] += elem.second;
+// Get the number of private-cache accesses admitted by spatial sampling,
+// summed across threads, from which the sampling error is estimated
+uint64_t bf_get_private_sampled_cache_accesses(void){
+  uint64_t res = 0;
+  for(auto& cache: *caches){
+    res += cache->getSampledAccesses();
   }
-  return out;
+  return res;
 }
 
-// Get cache hits
 uint64_t bf_get_shared_cache_accesses(void){
+  finish_cache_queues();
   return global_cache->getAccesses();
 }
 
 // Get cache hits
-vector<unordered_map<uint64_t,uint64_t> > bf_get_private_cache_hits(void){
+vector<LogHistogram> bf_get_private_cache_hits(void){
   // The total hits to a cache size N is equal to the sum of unique hits to all
   // caches sized N or smaller.  We'll aggregate the cache performance across
   // all threads; global L1 accesses is equivalent to the sum of individual L1
   // accesses, etc.
-  vector<unordered_map<uint64_t,uint64_t> > tot_hits(bf_max_set_bits + 1);
+  vector<LogHistogram> tot_hits(bf_max_set_bits);
   for(auto& cache: *caches){
-    auto hits = cache->getHits();
-    transform(begin(hits), end(hits), begin(tot_hits), begin(tot_hits), mapsum<unordered_map<uint64_t,uint64_t> >);
+    const auto& hits = cache->getHits();
+    for(uint64_t set = 0; set < bf_max_set_bits; ++set)
+      tot_hits[set] += hits[set];
   }
 
   return tot_hits;
 }
 
-vector<unordered_map<uint64_t,uint64_t> > bf_get_shared_cache_hits(void){
+const vector<LogHistogram>& bf_get_shared_cache_hits(void){
+  finish_cache_queues();
   return global_cache->getHits();
 }
 
-vector<unordered_map<uint64_t,uint64_t> > bf_get_remote_shared_cache_hits(void){
+const vector<LogHistogram>& bf_get_remote_shared_cache_hits(void){
+  finish_cache_queues();
   return global_cache->getRemoteHits();
 }
 
@@ -212,6 +1344,7 @@ uint64_t bf_get_private_cold_misses(void){
 }
 
 uint64_t bf_get_shared_cold_misses(void){
+  finish_cache_queues();
   return global_cache->getColdMisses();
 }
 
@@ -224,7 +1357,304 @@ uint64_t bf_get_private_misaligned_mem_ops(void){
 }
 
 uint64_t bf_get_shared_misaligned_mem_ops(void){
+  finish_cache_queues();
   return global_cache->getMisalignedMemOps();
 }
 
+uint64_t bf_get_private_store_accesses(void){
+  uint64_t res = 0;
+  for(auto& cache: *caches){
+    res += cache->getStoreAccesses();
+  }
+  return res;
+}
+
+// Get write-allocate fills, write-backs, and lines left dirty for a cache of
+// 2^set sets and a given associativity
+void bf_get_private_write_traffic(uint64_t set, uint64_t ways, uint64_t* fills,
+                                  uint64_t* writebacks, uint64_t* dirty){
+  *fills = 0;
+  *writebacks = 0;
+  *dirty = 0;
+  for(auto& cache: *caches){
+    uint64_t cache_fills, cache_writebacks, cache_dirty;
+    cache->getWriteTraffic(set, ways, &cache_fills, &cache_writebacks, &cache_dirty);
+    *fills += cache_fills;
+    *writebacks += cache_writebacks;
+    *dirty += cache_dirty;
+  }
+}
+
+void bf_get_shared_write_traffic(uint64_t set, uint64_t ways, uint64_t* fills,
+                                 uint64_t* writebacks, uint64_t* dirty){
+  finish_cache_queues();
+  global_cache->getWriteTraffic(set, ways, fills, writebacks, dirty);
+}
+
+uint64_t bf_get_private_prefetches(void){
+  uint64_t res = 0;
+  for(auto& cache: *caches){
+    res += cache->getPrefetches();
+  }
+  return res;
+}
+
+// Get prefetch fills and useful prefetches for a cache of 2^set sets and a
+// given associativity
+void bf_get_private_prefetch_traffic(uint64_t set, uint64_t ways,
+                                     uint64_t* fills, uint64_t* useful){
+  *fills = 0;
+  *useful = 0;
+  for(auto& cache: *caches){
+    uint64_t cache_fills, cache_useful;
+    cache->getPrefetchTraffic(set, ways, &cache_fills, &cache_useful);
+    *fills += cache_fills;
+    *useful += cache_useful;
+  }
+}
+
+void bf_get_shared_prefetch_traffic(uint64_t set, uint64_t ways,
+                                    uint64_t* fills, uint64_t* useful){
+  finish_cache_queues();
+  global_cache->getPrefetchTraffic(set, ways, fills, useful);
+}
+
+// Report per-level hit and miss counts for the modeled cache hierarchy, if
+// any, scaled up by the sample period.
+void bf_report_cache_hierarchy(void){
+  finish_cache_queues();
+  if(cache_hierarchy == nullptr)
+    return;
+  const vector<CacheLevelSpec>& specs = cache_hierarchy->getSpecs();
+  vector<uint64_t> hits(cache_hierarchy->getHits());
+  vector<uint64_t> misses(cache_hierarchy->getMisses());
+  vector<uint64_t> back_invals(cache_hierarchy->getBackInvalidations());
+  vector<uint64_t> store_misses(cache_hierarchy->getStoreMisses());
+  vector<uint64_t> writebacks(cache_hierarchy->getWritebacks());
+  uint64_t memory_writebacks = cache_hierarchy->getMemoryWritebacks()*bf_sample_period;
+  for(size_t i = 0; i < specs.size(); ++i){
+    hits[i] *= bf_sample_period;
+    misses[i] *= bf_sample_period;
+    back_invals[i] *= bf_sample_period;
+    store_misses[i] *= bf_sample_period;
+    writebacks[i] *= bf_sample_period;
+  }
+  static const char* inclusion_names[] = {"non-inclusive", "inclusive", "exclusive"};
+
+  // Output a textual miss rate for each level.
+  string tag(bf_output_prefix + "BYFL_SUMMARY");
+  for(size_t i = 0; i < specs.size(); ++i){
+    uint64_t accesses = hits[i] + misses[i];
+    double miss_rate = accesses == 0 ? 0.0 : double(misses[i])/double(accesses);
+    *bfout << tag << ": " << setw(25) << misses[i] << " L" << i + 1
+           << " misses (" << fixed << setw(5) << setprecision(1)
+           << miss_rate*100.0 << "% of " << accesses << " accesses)\n";
+  }
+  *bfout << tag << ": " << setw(25) << memory_writebacks
+         << " dirty lines written back to memory\n";
+
+  // Output a binary table with one row per level.
+  *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Cache hierarchy";
+  *bfbin << uint8_t(BINOUT_COL_UINT64) << "Level"
+         << uint8_t(BINOUT_COL_UINT64) << "Size (bytes)"
+         << uint8_t(BINOUT_COL_UINT64) << "Associativity"
+         << uint8_t(BINOUT_COL_UINT64) << "Sets"
+         << uint8_t(BINOUT_COL_UINT64) << "Line size (bytes)"
+         << uint8_t(BINOUT_COL_BOOL) << "Shared"
+         << uint8_t(BINOUT_COL_STRING) << "Inclusion"
+         << uint8_t(BINOUT_COL_UINT64) << "Accesses"
+         << uint8_t(BINOUT_COL_UINT64) << "Hits"
+         << uint8_t(BINOUT_COL_UINT64) << "Misses"
+         << uint8_t(BINOUT_COL_UINT64) << "Back-invalidations"
+         << uint8_t(BINOUT_COL_UINT64) << "Write-allocate fills"
+         << uint8_t(BINOUT_COL_UINT64) << "Write-backs"
+         << uint8_t(BINOUT_COL_NONE);
+  for(size_t i = 0; i < specs.size(); ++i){
+    *bfbin << uint8_t(BINOUT_ROW_DATA)
+           << uint64_t(i + 1) << specs[i].size << specs[i].ways << specs[i].sets
+           << bf_line_size << specs[i].shared << inclusion_names[specs[i].inclusion]
+           << hits[i] + misses[i] << hits[i] << misses[i] << back_invals[i]
+           << store_misses[i] << writebacks[i];
+  }
+  *bfbin << uint8_t(BINOUT_ROW_NONE);
+
+  // Output a binary summary of the hierarchy's memory traffic.
+  *bfbin << uint8_t(BINOUT_TABLE_KEYVAL) << "Cache hierarchy summary";
+  *bfbin << uint8_t(BINOUT_COL_UINT64) << "Lines read from memory" << misses.back()
+         << uint8_t(BINOUT_COL_UINT64) << "Lines written back to memory" << memory_writebacks
+         << uint8_t(BINOUT_COL_NONE);
+}
+
+// Report the cache lines that were transferred between writing threads,
+// both individually and aggregated by data structure, scaled up by the
+// sample period.
+void bf_report_cache_sharing(void){
+  finish_cache_queues();
+  if(sharing_detector == nullptr)
+    return;
+
+  // Gather the lines that were ever transferred, and aggregate them by data
+  // structure.
+  typedef SharingDetector::LineState LineState;
+  vector<pair<uint64_t, const LineState*> > shared_lines;
+  struct SharingTotals {
+    uint64_t lines;
+    uint64_t false_transfers;
+    uint64_t true_transfers;
+  };
+  map<uint32_t, SharingTotals> by_dstruct;
+  uint64_t false_lines = 0, true_lines = 0;
+  uint64_t false_transfers = 0, true_transfers = 0;
+  for(auto& line_state: sharing_detector->getLines()){
+    const LineState& state = line_state.second;
+    if(state.false_transfers + state.true_transfers == 0)
+      continue;
+    shared_lines.push_back(make_pair(line_state.first, &state));
+    false_lines += state.false_transfers > 0;
+    true_lines += state.true_transfers > 0;
+    false_transfers += state.false_transfers;
+    true_transfers += state.true_transfers;
+    SharingTotals& totals = by_dstruct[state.description];
+    ++totals.lines;
+    totals.false_transfers += state.false_transfers;
+    totals.true_transfers += state.true_transfers;
+  }
+
+  // Sort lines by decreasing false sharing, then by decreasing true sharing,
+  // then by increasing address.
+  sort(shared_lines.begin(), shared_lines.end(),
+       [](const pair<uint64_t, const LineState*>& a,
+          const pair<uint64_t, const LineState*>& b){
+         if(a.second->false_transfers != b.second->false_transfers)
+           return a.second->false_transfers > b.second->false_transfers;
+         if(a.second->true_transfers != b.second->true_transfers)
+           return a.second->true_transfers > b.second->true_transfers;
+         return a.first < b.first;
+       });
+
+  // Output a textual summary.
+  string tag(bf_output_prefix + "BYFL_SUMMARY");
+  *bfout << tag << ": " << setw(25) << false_lines*bf_sample_period
+         << " cache lines falsely shared ("
+         << false_transfers*bf_sample_period << " transfers between writers)\n";
+  *bfout << tag << ": " << setw(25) << true_lines*bf_sample_period
+         << " cache lines truly shared ("
+         << true_transfers*bf_sample_period << " transfers between writers)\n";
+
+  // Output each transferred line.
+  *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Cache-line sharing";
+  *bfbin << uint8_t(BINOUT_COL_UINT64) << "Line address"
+         << uint8_t(BINOUT_COL_UINT64) << "Writer threads"
+         << uint8_t(BINOUT_COL_UINT64) << "False-sharing transfers"
+         << uint8_t(BINOUT_COL_UINT64) << "True-sharing transfers"
+         << uint8_t(BINOUT_COL_STRING) << "Data structure"
+         << uint8_t(BINOUT_COL_NONE);
+  for(auto& line_state: shared_lines){
+    const LineState& state = *line_state.second;
+    *bfbin << uint8_t(BINOUT_ROW_DATA)
+           << line_state.first*bf_line_size
+           << uint64_t(__builtin_popcountll(state.writers))
+           << state.false_transfers << state.true_transfers
+           << sharing_detector->getDescription(state.description);
+  }
+  *bfbin << uint8_t(BINOUT_ROW_NONE);
+
+  // Output transfers aggregated by data structure.
+  *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "Cache-line sharing by data structure";
+  *bfbin << uint8_t(BINOUT_COL_STRING) << "Data structure"
+         << uint8_t(BINOUT_COL_UINT64) << "Shared lines"
+         << uint8_t(BINOUT_COL_UINT64) << "False-sharing transfers"
+         << uint8_t(BINOUT_COL_UINT64) << "True-sharing transfers"
+         << uint8_t(BINOUT_COL_NONE);
+  for(auto& ds_state: by_dstruct){
+    const SharingTotals& totals = ds_state.second;
+    *bfbin << uint8_t(BINOUT_ROW_DATA)
+           << sharing_detector->getDescription(ds_state.first)
+           << totals.lines*bf_sample_period
+           << totals.false_transfers*bf_sample_period
+           << totals.true_transfers*bf_sample_period;
+  }
+  *bfbin << uint8_t(BINOUT_ROW_NONE);
+}
+
+// Report, for each modeled page size, the LRU stack distances of page
+// accesses and the resulting hit curve of a fully associative TLB, scaled
+// up by the sample period.
+void bf_report_tlb_model(void){
+  if(all_tlbs == nullptr)
+    return;
+  uint64_t tlb_set_bits = min(bf_max_set_bits, tlb_max_set_bits);
+
+  // Aggregate the TLBs of all threads.
+  size_t num_sizes = tlb_page_sizes->size();
+  vector<uint64_t> accesses(num_sizes, 0);
+  vector<uint64_t> cold_misses(num_sizes, 0);
+  vector<vector<LogHistogram> > hits(num_sizes, vector<LogHistogram>(tlb_set_bits));
+  for(auto& thread_tlbs: *all_tlbs){
+    for(size_t i = 0; i < num_sizes; ++i){
+      Cache* tlb = (*thread_tlbs)[i];
+      accesses[i] += tlb->getAccesses();
+      cold_misses[i] += tlb->getColdMisses()*bf_sample_period;
+      const vector<LogHistogram>& tlb_hits = tlb->getHits();
+      for(uint64_t set = 0; set < tlb_set_bits; ++set)
+        hits[i][set] += tlb_hits[set];
+    }
+  }
+
+  // Output the number of distinct pages touched per page size.
+  string tag(bf_output_prefix + "BYFL_SUMMARY");
+  for(size_t i = 0; i < num_sizes; ++i)
+    *bfout << tag << ": " << setw(25) << cold_misses[i] << " distinct "
+           << (*tlb_page_sizes)[i] << "-byte pages accessed\n";
+
+  // Output the raw LRU stack distances, as for the cache model.
+  *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "TLB model data";
+  *bfbin << uint8_t(BINOUT_COL_UINT64) << "Page size"
+         << uint8_t(BINOUT_COL_UINT64) << "Set size"
+         << uint8_t(BINOUT_COL_UINT64) << "LRU search distance"
+         << uint8_t(BINOUT_COL_UINT64) << "Maximum LRU search distance"
+         << uint8_t(BINOUT_COL_UINT64) << "Tally"
+         << uint8_t(BINOUT_COL_NONE);
+  for(size_t i = 0; i < num_sizes; ++i){
+    for(uint64_t set = 0; set < tlb_set_bits; ++set){
+      for(size_t bin = 0; bin < LogHistogram::num_bins; ++bin){
+        uint64_t tally = hits[i][set][bin]*bf_sample_period;
+        if(tally == 0)
+          continue;
+        *bfbin << uint8_t(BINOUT_ROW_DATA)
+               << (*tlb_page_sizes)[i] << (uint64_t(1) << set)
+               << (LogHistogram::bin_min(bin) - 1)*bf_sample_period + 1
+               << LogHistogram::bin_max(bin)*bf_sample_period
+               << tally;
+      }
+    }
+  }
+  *bfbin << uint8_t(BINOUT_ROW_NONE);
+
+  // Output the hits and misses of a fully associative TLB for a range of
+  // power-of-two entry counts.  Beyond LogHistogram::exact_limit sampled
+  // entries, the hits include every distance in the bin holding the entry
+  // count, so each row states whether its counts are exact.
+  *bfbin << uint8_t(BINOUT_TABLE_BASIC) << "TLB reach";
+  *bfbin << uint8_t(BINOUT_COL_UINT64) << "Page size"
+         << uint8_t(BINOUT_COL_UINT64) << "Entries"
+         << uint8_t(BINOUT_COL_UINT64) << "Reach (bytes)"
+         << uint8_t(BINOUT_COL_UINT64) << "Hits"
+         << uint8_t(BINOUT_COL_UINT64) << "Misses"
+         << uint8_t(BINOUT_COL_BOOL) << "Exact"
+         << uint8_t(BINOUT_COL_NONE);
+  for(size_t i = 0; i < num_sizes; ++i){
+    for(uint64_t entries = 1; entries <= 65536; entries *= 2){
+      uint64_t sampled_entries = (entries - 1)/bf_sample_period + 1;
+      uint64_t tlb_hits = hits[i][0].count_at_most(sampled_entries)*bf_sample_period;
+      uint64_t tlb_misses = accesses[i] > tlb_hits ? accesses[i] - tlb_hits : 0;
+      *bfbin << uint8_t(BINOUT_ROW_DATA)
+             << (*tlb_page_sizes)[i] << entries << entries*(*tlb_page_sizes)[i]
+             << tlb_hits << tlb_misses
+             << LogHistogram::exact_at(sampled_entries);
+    }
+  }
+  *bfbin << uint8_t(BINOUT_ROW_NONE);
+}
+
 } // namespace bytesflops
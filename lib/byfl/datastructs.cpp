@@ -402,6 +402,21 @@ void bf_tag_data_region (void* address, const char *tag)
   (*data_structs)[diter->first] = new_counters;
 }
 
+// Return a description of the data structure containing a given address or
+// the empty string if the address isn't known to belong to a data
+// structure.
+string bf_describe_data_struct (uint64_t addr)
+{
+  if (data_structs == nullptr)
+    return "";
+  static Interval<uint64_t> search_addr(0, 0);
+  search_addr.lower = search_addr.upper = addr;
+  auto iter = data_structs->find(search_addr);
+  if (iter == data_structs->end())
+    return "";
+  return iter->second->generate_symbol_desc();
+}
+
 // Compare two counters with the intention of sorted them in decreasing
 // order of interestingness.  To that end, we sort first by decreasing
 // access count, then by decreasing memory footprint, then by increasing
@@ -0,0 +1,205 @@
+/*
+ * Helper library for computing bytes:flops ratios
+ * (flat address-map class definitions)
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#ifndef _FLATMAP_H_
+#define _FLATMAP_H_
+
+#include "byfl.h"
+
+using namespace std;
+
+// Map a 64-bit address (or any other 64-bit key) to a value using a flat,
+// open-addressing hash table.  Unlike an unordered_map, a FlatAddrMap stores
+// its key:value pairs directly in a single power-of-two-sized array, so a
+// lookup usually touches a single cache line and an insertion allocates
+// nothing unless the table has to grow.  Collisions are resolved by linear
+// probing, and erase() shifts later entries backward instead of leaving
+// tombstones, so lookups never slow down as entries come and go.
+//
+// Insertion may move existing entries, so iterators and references are
+// invalidated by operator[] but not by find().  One key value, ~0, marks an
+// empty slot; a pair with that key lives in an extra slot past the end of
+// the table.
+template<class T>
+class FlatAddrMap {
+public:
+  // Pairs are laid out like those of an STL map so that existing code can
+  // refer to iter->first and iter->second.
+  struct value_type {
+    uint64_t first;   // Key
+    T second;         // Value
+  };
+
+private:
+  static const uint64_t empty_key = ~uint64_t(0);
+  static const size_t min_capacity = 16;
+  vector<value_type> slots;  // capacity regular slots plus one for empty_key
+  size_t mask;               // Capacity minus one
+  unsigned shift;            // 64 minus log2(capacity)
+  size_t num_entries;        // Number of occupied slots, including the extra one
+  bool has_empty_key;        // true if the extra slot is occupied
+
+  // Return the preferred slot for a key (Fibonacci hashing).
+  size_t home_slot(uint64_t key) const {
+    return size_t((key*UINT64_C(0x9E3779B97F4A7C15)) >> shift);
+  }
+
+  // Return true if a given slot holds a key:value pair.
+  bool occupied(size_t idx) const {
+    return idx <= mask ? slots[idx].first != empty_key : has_empty_key;
+  }
+
+  // Allocate an empty table with a given power-of-two capacity.
+  void allocate(size_t capacity) {
+    slots.assign(capacity + 1, value_type{empty_key, T()});
+    mask = capacity - 1;
+    shift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1)
+      shift--;
+  }
+
+  // Double the table's capacity and reinsert every pair.
+  void grow() {
+    vector<value_type> old_slots;
+    old_slots.swap(slots);
+    size_t old_capacity = mask + 1;
+    allocate(old_capacity*2);
+    for (size_t i = 0; i < old_capacity; i++)
+      if (old_slots[i].first != empty_key) {
+        size_t idx = home_slot(old_slots[i].first);
+        while (slots[idx].first != empty_key)
+          idx = (idx + 1) & mask;
+        slots[idx] = old_slots[i];
+      }
+    slots[mask + 1] = old_slots[old_capacity];
+  }
+
+  // Return the slot holding a key or, if the key is absent, the number of
+  // slots.
+  size_t find_slot(uint64_t key) const {
+    if (key == empty_key)
+      return has_empty_key ? mask + 1 : slots.size();
+    for (size_t idx = home_slot(key); ; idx = (idx + 1) & mask) {
+      uint64_t slot_key = slots[idx].first;
+      if (slot_key == key)
+        return idx;
+      if (slot_key == empty_key)
+        return slots.size();
+    }
+  }
+
+  // Iterate over all occupied slots.
+  template<class map_type, class pair_type>
+  class any_iterator {
+  private:
+    map_type* the_map;   // Map being iterated over
+    size_t idx;          // Current slot
+
+    void skip_empty() {
+      while (idx < the_map->slots.size() && !the_map->occupied(idx))
+        idx++;
+    }
+
+  public:
+    any_iterator(map_type* m, size_t i) : the_map(m), idx(i) { skip_empty(); }
+    pair_type& operator*() const { return the_map->slots[idx]; }
+    pair_type* operator->() const { return &the_map->slots[idx]; }
+    any_iterator& operator++() { idx++; skip_empty(); return *this; }
+    any_iterator operator++(int) { any_iterator prev = *this; ++*this; return prev; }
+    bool operator==(const any_iterator& other) const { return idx == other.idx; }
+    bool operator!=(const any_iterator& other) const { return idx != other.idx; }
+  };
+
+public:
+  typedef any_iterator<FlatAddrMap, value_type> iterator;
+  typedef any_iterator<const FlatAddrMap, const value_type> const_iterator;
+
+  FlatAddrMap() : num_entries(0), has_empty_key(false) {
+    allocate(min_capacity);
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  iterator end() { return iterator(this, slots.size()); }
+  const_iterator end() const { return const_iterator(this, slots.size()); }
+
+  size_t size() const { return num_entries; }
+
+  // Return the number of bytes of memory the table occupies.
+  size_t bytes_used() const { return slots.capacity()*sizeof(value_type); }
+
+  // Return an iterator to a key:value pair or end() if the key is absent.
+  iterator find(uint64_t key) { return iterator(this, find_slot(key)); }
+  const_iterator find(uint64_t key) const { return const_iterator(this, find_slot(key)); }
+
+  // Return a reference to a key's value, inserting a default-constructed
+  // value if the key is absent.
+  T& operator[] (uint64_t key) {
+    if (key == empty_key) {
+      if (!has_empty_key) {
+        has_empty_key = true;
+        num_entries++;
+        slots[mask + 1].first = empty_key;
+        slots[mask + 1].second = T();
+      }
+      return slots[mask + 1].second;
+    }
+    size_t idx = home_slot(key);
+    for (; slots[idx].first != empty_key; idx = (idx + 1) & mask)
+      if (slots[idx].first == key)
+        return slots[idx].second;
+
+    // The key is absent.  Grow the table if it would become more than 3/4
+    // full, then insert the key.
+    if ((num_entries + 1)*4 > (mask + 1)*3) {
+      grow();
+      for (idx = home_slot(key); slots[idx].first != empty_key; idx = (idx + 1) & mask)
+        ;
+    }
+    num_entries++;
+    slots[idx].first = key;
+    slots[idx].second = T();
+    return slots[idx].second;
+  }
+
+  // Remove a key:value pair and return the number of pairs removed (0 or 1).
+  // Later pairs in the same probe sequence are shifted back to fill the hole.
+  size_t erase(uint64_t key) {
+    size_t hole = find_slot(key);
+    if (hole == slots.size())
+      return 0;
+    num_entries--;
+    if (hole > mask) {
+      has_empty_key = false;
+      return 1;
+    }
+    for (size_t idx = (hole + 1) & mask; slots[idx].first != empty_key; idx = (idx + 1) & mask) {
+      // Move the pair at idx into the hole unless its home slot lies
+      // cyclically after the hole and at or before idx.
+      size_t home = home_slot(slots[idx].first);
+      if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+        slots[hole] = slots[idx];
+        hole = idx;
+      }
+    }
+    slots[hole].first = empty_key;
+    slots[hole].second = T();
+    return 1;
+  }
+
+  // sorted_keys() returns a pointer to a vector of keys in sorted order.
+  template <typename SortFn = std::less<uint64_t> >
+  vector<uint64_t>* sorted_keys (SortFn compare = SortFn() ) const {
+    vector<uint64_t>* keys = new vector<uint64_t>();
+    for (const_iterator iter = begin(); iter != end(); iter++)
+      keys->push_back(iter->first);
+    sort(keys->begin(), keys->end(), compare);
+    return keys;
+  }
+};
+
+#endif
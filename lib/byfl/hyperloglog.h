@@ -0,0 +1,124 @@
+/*
+ * Helper library for computing bytes:flops ratios
+ * (HyperLogLog cardinality-sketch class definitions)
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#ifndef _HYPERLOGLOG_H_
+#define _HYPERLOGLOG_H_
+
+#include "byfl.h"
+#include <cmath>
+
+using namespace std;
+
+namespace bytesflops {
+
+// A HyperLogLog estimates the number of distinct 64-bit keys inserted into it
+// using a fixed 2^precision bytes of memory.  Each key is hashed; the top
+// precision bits of the hash select a register, and the register remembers
+// the longest run of leading zeros seen in the remaining bits.  The estimate
+// has a relative standard error of about 1.04/sqrt(2^precision).  Small
+// cardinalities fall back to linear counting of empty registers, and
+// sketches merge by taking the elementwise maximum of their registers.
+// Address ranges can be counted at a coarser granularity than bytes, in
+// which case each aligned granule counts as that many bytes.
+class HyperLogLog {
+private:
+  unsigned precision;          // log2 of the number of registers
+  unsigned granule_bits;       // log2 of the bytes per granule inserted by insert_range()
+  vector<uint8_t> registers;   // Longest zero run (plus one) seen per register
+
+  // Scramble a key so that nearby addresses hash to unrelated values
+  // (the SplitMix64 finalizer).
+  static uint64_t mix (uint64_t key) {
+    key ^= key >> 30;
+    key *= UINT64_C(0xBF58476D1CE4E5B9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94D049BB133111EB);
+    key ^= key >> 31;
+    return key;
+  }
+
+public:
+  static const unsigned min_precision = 4;
+  static const unsigned max_precision = 18;
+
+  HyperLogLog(unsigned bits, uint64_t granularity=1) :
+    precision(bits), granule_bits(0), registers(size_t(1) << bits, 0) {
+    for (uint64_t gran = granularity; gran > 1; gran >>= 1)
+      granule_bits++;
+  }
+
+  // Return the relative standard error of a sketch with a given precision.
+  static double relative_error (unsigned bits) {
+    return 1.04/sqrt(double(uint64_t(1) << bits));
+  }
+
+  // Insert a single key.
+  void insert (uint64_t key) {
+    uint64_t hash = mix(key);
+    size_t idx = size_t(hash >> (64 - precision));
+    uint64_t rest = hash << precision;
+    uint8_t rank = rest == 0 ? uint8_t(64 - precision + 1) : uint8_t(__builtin_clzll(rest) + 1);
+    if (rank > registers[idx])
+      registers[idx] = rank;
+  }
+
+  // Insert every granule that overlaps the address range [base, base+num).
+  void insert_range (uint64_t base, uint64_t num) {
+    if (num == 0)
+      return;
+    uint64_t last = (base + num - 1) >> granule_bits;
+    for (uint64_t granule = base >> granule_bits; granule <= last; granule++)
+      insert(granule);
+  }
+
+  // Merge another sketch of the same precision and granularity into ours.
+  void merge (const HyperLogLog& other) {
+    for (size_t i = 0; i < registers.size(); i++)
+      if (other.registers[i] > registers[i])
+        registers[i] = other.registers[i];
+  }
+
+  // Estimate the number of distinct keys inserted so far.  Granules
+  // inserted by insert_range() are scaled to bytes.
+  uint64_t estimate (void) const {
+    double m = double(registers.size());
+    double inv_sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < registers.size(); i++) {
+      inv_sum += ldexp(1.0, -int(registers[i]));
+      zeros += registers[i] == 0;
+    }
+    double alpha;
+    switch (precision) {
+      case 4:
+        alpha = 0.673;
+        break;
+      case 5:
+        alpha = 0.697;
+        break;
+      case 6:
+        alpha = 0.709;
+        break;
+      default:
+        alpha = 0.7213/(1.0 + 1.079/m);
+        break;
+    }
+    double raw = alpha*m*m/inv_sum;
+    if (raw <= 2.5*m && zeros > 0)
+      raw = m*log(m/double(zeros));
+    return uint64_t(raw + 0.5) << granule_bits;
+  }
+
+  // Return the number of bytes of memory used by the sketch.
+  size_t bytes_used() const {
+    return sizeof(*this) + registers.capacity();
+  }
+};
+
+} // namespace bytesflops
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Helper library for computing bytes:flops ratios
+ * (log-binned histogram class definitions)
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#ifndef _LOGHIST_H_
+#define _LOGHIST_H_
+
+#include "byfl.h"
+
+using namespace std;
+
+namespace bytesflops {
+
+// The following functions define the binning shared by LogHistogram and
+// HdrHistogram.  Values below 2^exact_bits get one bin apiece.  Larger
+// values are binned logarithmically, with each power of two split into
+// 2^sub_bin_bits bins of equal width, so a bin's width never exceeds
+// 2^-sub_bin_bits of its lower bound.  sub_bin_bits must not exceed
+// exact_bits.
+
+// Map a value to its bin number.
+inline size_t log_bin_of (uint64_t value, unsigned exact_bits, unsigned sub_bin_bits)
+{
+  uint64_t exact_limit = uint64_t(1) << exact_bits;
+  if (value < exact_limit)
+    return value;
+  unsigned msb = 63 - __builtin_clzll(value);
+  uint64_t sub = (value >> (msb - sub_bin_bits)) & ((uint64_t(1) << sub_bin_bits) - 1);
+  return exact_limit + (size_t(msb - exact_bits) << sub_bin_bits) + sub;
+}
+
+// Return the smallest value that maps to a given bin.
+inline uint64_t log_bin_min (size_t bin, unsigned exact_bits, unsigned sub_bin_bits)
+{
+  uint64_t exact_limit = uint64_t(1) << exact_bits;
+  if (bin < exact_limit)
+    return bin;
+  unsigned msb = exact_bits + unsigned((bin - exact_limit) >> sub_bin_bits);
+  uint64_t sub = (bin - exact_limit) & ((uint64_t(1) << sub_bin_bits) - 1);
+  return (uint64_t(1) << msb) | (sub << (msb - sub_bin_bits));
+}
+
+// Return the largest value that maps to a given bin.
+inline uint64_t log_bin_max (size_t bin, unsigned exact_bits, unsigned sub_bin_bits)
+{
+  uint64_t exact_limit = uint64_t(1) << exact_bits;
+  if (bin < exact_limit)
+    return bin;
+  unsigned msb = exact_bits + unsigned((bin - exact_limit) >> sub_bin_bits);
+  return log_bin_min(bin, exact_bits, sub_bin_bits) + (uint64_t(1) << (msb - sub_bin_bits)) - 1;
+}
+
+// A LogHistogram tallies 64-bit values in a fixed number of bins, using
+// the binning above with a fixed precision.  Updates are a single array
+// increment, and histograms merge by elementwise addition.
+class LogHistogram {
+public:
+  static const unsigned exact_bits = 7;      // log2(exact_limit)
+  static const unsigned sub_bin_bits = 3;    // log2(sub_bins)
+  static const uint64_t exact_limit = uint64_t(1) << exact_bits;
+  static const uint64_t sub_bins = uint64_t(1) << sub_bin_bits;
+  static const size_t num_bins = exact_limit + (64 - exact_bits)*sub_bins;
+
+  LogHistogram() : bins(num_bins, 0) { }
+
+  // Map a value to its bin number.
+  static size_t bin_of (uint64_t value) {
+    return log_bin_of(value, exact_bits, sub_bin_bits);
+  }
+
+  // Return the smallest value that maps to a given bin.
+  static uint64_t bin_min (size_t bin) {
+    return log_bin_min(bin, exact_bits, sub_bin_bits);
+  }
+
+  // Return the largest value that maps to a given bin.
+  static uint64_t bin_max (size_t bin) {
+    return log_bin_max(bin, exact_bits, sub_bin_bits);
+  }
+
+  // Tally a value.
+  void increment (uint64_t value, uint64_t count=1) {
+    bins[bin_of(value)] += count;
+  }
+
+  // Return the tally in a given bin.
+  uint64_t operator[] (size_t bin) const {
+    return bins[bin];
+  }
+
+  // Return the total tally of values not exceeding a given value.  This is
+  // exact if the value lies in the exact range; otherwise, the entire bin
+  // containing the value is included.
+  uint64_t count_at_most (uint64_t value) const {
+    uint64_t total = 0;
+    size_t last_bin = bin_of(value);
+    for (size_t i = 0; i <= last_bin; i++)
+      total += bins[i];
+    return total;
+  }
+
+  // Return true if count_at_most() and count_above() are exact for a given
+  // value, that is, if the value is the largest in its bin.
+  static bool exact_at (uint64_t value) {
+    return bin_max(bin_of(value)) == value;
+  }
+
+  // Return the total tally of values exceeding a given value (subject to
+  // the same binning caveat as count_at_most()).
+  uint64_t count_above (uint64_t value) const {
+    uint64_t total = 0;
+    for (size_t i = bin_of(value) + 1; i < num_bins; i++)
+      total += bins[i];
+    return total;
+  }
+
+  // Accumulate another histogram into this one.
+  LogHistogram& operator+= (const LogHistogram& other) {
+    for (size_t i = 0; i < num_bins; i++)
+      bins[i] += other.bins[i];
+    return *this;
+  }
+
+private:
+  vector<uint64_t> bins;     // Tally for each bin
+};
+
+// An HdrHistogram uses the same binning as a LogHistogram but with a
+// precision chosen at run time.  With p precision bits, values below
+// 2^(p+1) get one bin apiece, and each larger power of two is split into 2^p
+// bins.  Bins are allocated only up to the largest value tallied, so a
+// single large value costs at most a few thousand bins.
+class HdrHistogram {
+public:
+  HdrHistogram(unsigned precision_bits) :
+    sub_bin_bits(precision_bits),
+    exact_bits(precision_bits + 1) { }
+
+  // Map a value to its bin number.
+  size_t bin_of (uint64_t value) const {
+    return log_bin_of(value, exact_bits, sub_bin_bits);
+  }
+
+  // Return the smallest value that maps to a given bin.
+  uint64_t bin_min (size_t bin) const {
+    return log_bin_min(bin, exact_bits, sub_bin_bits);
+  }
+
+  // Return the largest value that maps to a given bin.
+  uint64_t bin_max (size_t bin) const {
+    return log_bin_max(bin, exact_bits, sub_bin_bits);
+  }
+
+  // Tally a value.
+  void increment (uint64_t value, uint64_t count=1) {
+    size_t bin = bin_of(value);
+    if (bin >= bins.size())
+      bins.resize(bin + 1, 0);
+    bins[bin] += count;
+  }
+
+  // Return the tally in a given bin.
+  uint64_t operator[] (size_t bin) const {
+    return bin < bins.size() ? bins[bin] : 0;
+  }
+
+  // Return the number of bins allocated so far.  All higher bins are empty.
+  size_t size() const { return bins.size(); }
+
+  // Empty the histogram.
+  void reset() { bins.clear(); }
+
+  // Accumulate another histogram with the same precision into this one.
+  HdrHistogram& operator+= (const HdrHistogram& other) {
+    if (other.bins.size() > bins.size())
+      bins.resize(other.bins.size(), 0);
+    for (size_t i = 0; i < other.bins.size(); i++)
+      bins[i] += other.bins[i];
+    return *this;
+  }
+
+  // Return the number of values below which every value has its own bin.
+  uint64_t get_exact_limit() const { return uint64_t(1) << exact_bits; }
+
+  // Return the number of bins into which each larger power of two is split.
+  uint64_t get_sub_bins() const { return uint64_t(1) << sub_bin_bits; }
+
+private:
+  unsigned sub_bin_bits;     // log2 of the bins per power of two
+  unsigned exact_bits;       // log2 of the values binned exactly
+  vector<uint64_t> bins;     // Tally for each bin
+};
+
+} // namespace bytesflops
+
+#endif
@@ -5,12 +5,112 @@
 * By Scott Pakin <pakin@lanl.gov>
 */
 
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
 #include "byfl.h"
 
 using namespace std;
 
 namespace bytesflops {
 
+// Define the state of the file-backed arena used by PageArena.
+static const size_t arena_chunk_size = size_t(256) << 20;  // Bytes per mapped chunk
+static int arena_fd = -1;                   // Backing file or -1 to use the heap
+static uint64_t arena_file_size = 0;        // Bytes of backing file mapped so far
+static vector<pair<char*, size_t> > arena_chunks;    // {address, bytes} of each chunk
+static char* arena_next = nullptr;          // Next unallocated byte of the last chunk
+static char* arena_end = nullptr;           // End of the last chunk
+static map<size_t, vector<void*> > arena_free_lists;  // Released blocks by size
+static uint64_t arena_resident_limit = 0;   // Bytes to hand out between trims
+static uint64_t arena_since_trim = 0;       // Bytes handed out since the last trim
+static mutex arena_mutex;                   // Protect all of the above
+
+// Back all subsequent allocations with a temporary file in a given directory
+// and keep roughly at most resident_limit bytes in memory.
+void PageArena::configure(const char* dirname, uint64_t resident_limit)
+{
+  lock_guard<mutex> guard(arena_mutex);
+  string filename = string(dirname) + "/byfl-pagetable-XXXXXX";
+  vector<char> template_name(filename.begin(), filename.end());
+  template_name.push_back('\0');
+  arena_fd = mkstemp(template_name.data());
+  if (arena_fd == -1) {
+    cerr << "Failed to create a page-table file in " << dirname << " (" << strerror(errno) << ")\n";
+    bf_abend();
+  }
+  unlink(template_name.data());
+  arena_resident_limit = resident_limit;
+}
+
+// Write every chunk back to the file and drop it from memory.
+static void trim_arena()
+{
+  for (auto citer = arena_chunks.begin(); citer != arena_chunks.end(); citer++) {
+    msync(citer->first, citer->second, MS_SYNC);
+    madvise(citer->first, citer->second, MADV_DONTNEED);
+  }
+  posix_fadvise(arena_fd, 0, 0, POSIX_FADV_DONTNEED);
+  arena_since_trim = 0;
+}
+
+// Allocate a block of memory.
+void* PageArena::allocate(size_t bytes)
+{
+  if (arena_fd == -1)
+    return new char[bytes];
+  lock_guard<mutex> guard(arena_mutex);
+
+  // Periodically bound the memory the arena keeps resident.
+  arena_since_trim += bytes;
+  if (arena_resident_limit > 0 && arena_since_trim > arena_resident_limit)
+    trim_arena();
+
+  // Reuse a released block if one of the right size exists.
+  vector<void*>& free_list = arena_free_lists[bytes];
+  if (!free_list.empty()) {
+    void* block = free_list.back();
+    free_list.pop_back();
+    return block;
+  }
+
+  // Extend the file and map a new chunk if the current one is full.
+  if (arena_next == nullptr || size_t(arena_end - arena_next) < bytes) {
+    size_t chunk_bytes = max(arena_chunk_size, bytes);
+    if (ftruncate(arena_fd, off_t(arena_file_size + chunk_bytes)) == -1) {
+      cerr << "Failed to extend the page-table file (" << strerror(errno) << ")\n";
+      bf_abend();
+    }
+    void* chunk = mmap(nullptr, chunk_bytes, PROT_READ|PROT_WRITE, MAP_SHARED,
+                       arena_fd, off_t(arena_file_size));
+    if (chunk == MAP_FAILED) {
+      cerr << "Failed to map the page-table file (" << strerror(errno) << ")\n";
+      bf_abend();
+    }
+    arena_file_size += chunk_bytes;
+    arena_chunks.push_back(make_pair((char*)chunk, chunk_bytes));
+    arena_next = (char*)chunk;
+    arena_end = arena_next + chunk_bytes;
+  }
+  void* block = arena_next;
+  arena_next += bytes;
+  return block;
+}
+
+// Release a block of memory returned by allocate().
+void PageArena::release(void* ptr, size_t bytes)
+{
+  if (ptr == nullptr)
+    return;
+  if (arena_fd == -1) {
+    delete[] (char*)ptr;
+    return;
+  }
+  lock_guard<mutex> guard(arena_mutex);
+  arena_free_lists[bytes].push_back(ptr);
+}
+
 // Construct a page-table entry for bit-sized counters.
 BitPageTableEntry::BitPageTableEntry(size_t pg_size) : BasePageTableEntry(pg_size)
 {
@@ -54,17 +154,19 @@ void BitPageTableEntry::increment(size_t pos1, size_t pos2)
     bit_vector[word_ofs1] = new_word;
   }
   else {
-    // Slow case -- positions span multiple words.
-    for (size_t pos = pos1; pos <= pos2; pos++) {
-      size_t word_ofs = pos/64;             // Word containing the bit of interest
-      size_t bit_ofs = pos%64;              // Bit offset in the target word
-      uint64_t word = bit_vector[word_ofs]; // Vector of 64 bits
-      uint64_t mask = 1ULL<<bit_ofs;        // All 0s except for bitofs
-      if ((word&mask) == 0ULL) {
-        // Bit was previously 0.  Set it to 1.
-        bit_vector[word_ofs] |= mask;
-        bytes_touched++;
-      }
+    // Slow case -- positions span multiple words.  Set the partial first and
+    // last words with masks and every word in between wholesale.
+    uint64_t first_mask = ~0ULL << (pos1%64);
+    uint64_t last_mask = ~0ULL >> (63 - pos2%64);
+    for (size_t w = word_ofs1; w <= word_ofs2; w++) {
+      uint64_t mask = ~0ULL;
+      if (w == word_ofs1)
+        mask &= first_mask;
+      if (w == word_ofs2)
+        mask &= last_mask;
+      uint64_t word = bit_vector[w];
+      bytes_touched += __builtin_popcountll(~word & mask);
+      bit_vector[w] = word | mask;
     }
   }
 
@@ -83,97 +185,247 @@ void BitPageTableEntry::merge(BitPageTableEntry* other)
   if (!bit_vector)
     return;
 
-  // If the other PTE is full, set all of our bits to 1.
-  if (other->bit_vector == nullptr) {
+  // If the other PTE is full, so is ours.
+  if (other->bit_vector == nullptr)
+    bytes_touched = logical_page_size;
+  else
+    // Merge word-by-word, tallying the bits that change from zero to one.
     for (size_t w = 0; w < logical_page_size/64; w++) {
       uint64_t word0 = bit_vector[w];
-      for (size_t b = 0; b < 64; b++) {
-        uint64_t bit0 = word0 & (1ULL<<b);
-        uint64_t bit1 = 1ULL<<b;
-        if (bit0 == 0ULL) {
-          word0 |= bit1;
-          bytes_touched++;
-        }
-      }
-      bit_vector[w] = word0;
+      uint64_t word1 = other->bit_vector[w];
+      bytes_touched += __builtin_popcountll(~word0 & word1);
+      bit_vector[w] = word0 | word1;
     }
-    return;
+
+  // As in increment(), deallocate the bit vector of a full page.
+  if (bytes_touched == logical_page_size) {
+    delete[] bit_vector;
+    bit_vector = NULL;
   }
+}
 
-  // Merge bit-by-bit, incrementing bytes_touched on any transition
-  // from zero to one.
+// Mark as touched each byte whose bit is set in a page-sized bit mask.
+void BitPageTableEntry::mark(const uint64_t* bits)
+{
+  // Do nothing if our page is full.
+  if (!bit_vector)
+    return;
+
+  // Merge word-by-word, tallying the bits that change from zero to one.
   for (size_t w = 0; w < logical_page_size/64; w++) {
-    uint64_t word0 = bit_vector[w];
-    uint64_t word1 = other->bit_vector[w];
-    for (size_t b = 0; b < 64; b++) {
-      uint64_t bit0 = word0 & (1ULL<<b);
-      uint64_t bit1 = word1 & (1ULL<<b);
-      if (bit0 == 0ULL && bit1 != 0ULL) {
-        word0 |= bit1;
-        bytes_touched++;
-      }
-    }
-    bit_vector[w] = word0;
+    uint64_t word = bit_vector[w];
+    bytes_touched += __builtin_popcountll(~word & bits[w]);
+    bit_vector[w] = word | bits[w];
+  }
+
+  // As in increment(), deallocate the bit vector of a full page.
+  if (bytes_touched == logical_page_size) {
+    delete[] bit_vector;
+    bit_vector = NULL;
   }
 }
 
+// Fill a page-sized bit mask with one bit per touched byte.
+void BitPageTableEntry::touched_bits(uint64_t* bits) const
+{
+  if (bit_vector)
+    memcpy((void *)bits, bit_vector, sizeof(uint64_t)*logical_page_size/64);
+  else
+    memset((void *)bits, 0xFF, sizeof(uint64_t)*logical_page_size/64);
+}
+
 // Construct a page-table entry for word-sized counters.
 WordPageTableEntry::WordPageTableEntry(size_t pg_size) : BasePageTableEntry(pg_size)
 {
   bytes_touched = 0;
-  byte_counter = new bytecount_t[logical_page_size];
-  memset((void *)byte_counter, 0, sizeof(bytecount_t)*logical_page_size);
+  small_counter = (uint8_t*)PageArena::allocate(logical_page_size);
+  memset((void *)small_counter, 0, logical_page_size);
+  overflow = nullptr;
+  wide_counter = nullptr;
 }
 
 // Copy an existing page-table entry.
 WordPageTableEntry::WordPageTableEntry(const WordPageTableEntry& other) : BasePageTableEntry(other)
 {
-  byte_counter = new bytecount_t[logical_page_size];
-  memcpy((void *)byte_counter, other.byte_counter, sizeof(bytecount_t)*logical_page_size);
+  small_counter = nullptr;
+  overflow = nullptr;
+  wide_counter = nullptr;
+  if (other.wide_counter != nullptr) {
+    wide_counter = (bytecount_t*)PageArena::allocate(sizeof(bytecount_t)*logical_page_size);
+    memcpy((void *)wide_counter, other.wide_counter, sizeof(bytecount_t)*logical_page_size);
+    return;
+  }
+  small_counter = (uint8_t*)PageArena::allocate(logical_page_size);
+  memcpy((void *)small_counter, other.small_counter, logical_page_size);
+  if (other.overflow != nullptr)
+    overflow = new FlatAddrMap<bytecount_t>(*other.overflow);
 }
 
 // Destruct a word-sized page-table entry.
 WordPageTableEntry::~WordPageTableEntry()
 {
-  delete[] byte_counter;
+  PageArena::release(small_counter, logical_page_size);
+  delete overflow;
+  PageArena::release(wide_counter, sizeof(bytecount_t)*logical_page_size);
+}
+
+// Switch from small to full-width counters.
+void WordPageTableEntry::widen()
+{
+  bytecount_t* counters = (bytecount_t*)PageArena::allocate(sizeof(bytecount_t)*logical_page_size);
+  for (size_t pos = 0; pos < logical_page_size; pos++)
+    counters[pos] = count_at(pos);
+  PageArena::release(small_counter, logical_page_size);
+  small_counter = nullptr;
+  delete overflow;
+  overflow = nullptr;
+  wide_counter = counters;
+}
+
+// Add to the tally of a single byte, clamping at the maximum word value.
+// Counts that no longer fit in a small counter move to the overflow table.
+void WordPageTableEntry::add_count(size_t pos, bytecount_t count)
+{
+  bytecount_t old_count = count_at(pos);
+  if (old_count == 0 && count > 0)
+    bytes_touched++;
+  bytecount_t new_count = old_count + count;
+  if (new_count < old_count)
+    new_count = bf_max_bytecount;
+  if (wide_counter != nullptr) {
+    wide_counter[pos] = new_count;
+    return;
+  }
+  if (new_count < overflow_count) {
+    small_counter[pos] = uint8_t(new_count);
+    return;
+  }
+  if (overflow == nullptr)
+    overflow = new FlatAddrMap<bytecount_t>();
+  small_counter[pos] = overflow_count;
+  (*overflow)[pos] = new_count;
+}
+
+// Process counters a few at a time using the compiler's generic vector
+// types, which map onto whatever SIMD instructions the target provides.
+// Comparisons produce all ones (i.e., -1) in each lane for which they hold.
+// A group of small counters that includes any counter near overflow is
+// processed one counter at a time instead.
+typedef uint8_t counter_vec_t __attribute__((vector_size(16), aligned(1)));
+static const size_t counter_lanes = sizeof(counter_vec_t);
+typedef bytecount_t bytecount_vec_t
+  __attribute__((vector_size(16), aligned(sizeof(bytecount_t))));
+static const size_t bytecount_lanes = sizeof(bytecount_vec_t)/sizeof(bytecount_t);
+
+// Return the number of lanes of a small-counter comparison that are true.
+static inline size_t count_true_lanes (counter_vec_t mask)
+{
+  uint64_t halves[2];
+  memcpy(halves, &mask, sizeof(halves));
+  return size_t(__builtin_popcountll(halves[0]) + __builtin_popcountll(halves[1]))/8;
+}
+
+// Increment the full-width tallies associated with a range of bytes,
+// clamping each at the maximum word value.
+void WordPageTableEntry::increment_wide(size_t pos1, size_t pos2)
+{
+  size_t pos = pos1;
+  if (pos2 - pos1 + 1 >= bytecount_lanes) {
+    // Increment bytecount_lanes counters at a time, and count the number of
+    // counters that were zero.
+    bytecount_vec_t zeros = {0};
+    for (; pos + bytecount_lanes <= pos2 + 1; pos += bytecount_lanes) {
+      bytecount_vec_t counts;
+      memcpy(&counts, &wide_counter[pos], sizeof(counts));
+      zeros -= (bytecount_vec_t)(counts == 0);
+      counts += (bytecount_vec_t)(counts != bf_max_bytecount) & 1;
+      memcpy(&wide_counter[pos], &counts, sizeof(counts));
+    }
+    for (size_t i = 0; i < bytecount_lanes; i++)
+      bytes_touched += zeros[i];
+  }
+  for (; pos <= pos2; pos++) {
+    bytecount_t count = wide_counter[pos];
+    bytes_touched += count == 0;
+    wide_counter[pos] = count + (count != bf_max_bytecount);
+  }
 }
 
 // Increment the tallies associated with a range of bytes, clamping each at the
 // maximum word value.
 void WordPageTableEntry::increment(size_t pos1, size_t pos2)
 {
-  for (size_t pos = pos1; pos <= pos2; pos++)
-    switch (byte_counter[pos]) {
-      case bf_max_bytecount:
-        /* Maxed out our counter -- don't increment it further. */
-        break;
-
-      case 0:
-        /* First time a byte was touched */
-        bytes_touched++;
-        /* No break */
-
-      default:
-        /* Common case -- increment the counter. */
-        byte_counter[pos]++;
-        break;
+  if (wide_counter != nullptr) {
+    increment_wide(pos1, pos2);
+    return;
+  }
+  size_t pos = pos1;
+  for (; pos + counter_lanes <= pos2 + 1; pos += counter_lanes) {
+    counter_vec_t counts;
+    memcpy(&counts, &small_counter[pos], sizeof(counts));
+    if (count_true_lanes((counter_vec_t)(counts >= overflow_count - 1)) > 0) {
+      for (size_t i = 0; i < counter_lanes; i++)
+        add_count(pos + i, 1);
+      continue;
     }
+    bytes_touched += count_true_lanes((counter_vec_t)(counts == 0));
+    counts += 1;
+    memcpy(&small_counter[pos], &counts, sizeof(counts));
+  }
+  for (; pos <= pos2; pos++) {
+    uint8_t count = small_counter[pos];
+    if (count < overflow_count - 1) {
+      bytes_touched += count == 0;
+      small_counter[pos] = count + 1;
+    }
+    else
+      add_count(pos, 1);
+  }
+  widen_if_crowded();
 }
 
 // Merge the counts from another WordPageTableEntry into ours.
 void WordPageTableEntry::merge(WordPageTableEntry* other)
 {
-  for (size_t pos = 0; pos < logical_page_size; pos++) {
-    bytecount_t count0 = byte_counter[pos];
-    bytecount_t count1 = other->byte_counter[pos];
-    if (count1 == 0)
+  // If either entry uses full-width counters, merge one counter at a time.
+  size_t pos = 0;
+  if (wide_counter != nullptr || other->wide_counter != nullptr) {
+    for (; pos < logical_page_size; pos++)
+      add_count(pos, other->count_at(pos));
+    widen_if_crowded();
+    return;
+  }
+
+  // Add counter_lanes pairs of small counters at a time, and count the bytes
+  // that only the other PTE touched.
+  const uint8_t* other_counter = other->small_counter;
+  for (; pos + counter_lanes <= logical_page_size; pos += counter_lanes) {
+    counter_vec_t count0, count1;
+    memcpy(&count0, &small_counter[pos], sizeof(count0));
+    memcpy(&count1, &other_counter[pos], sizeof(count1));
+    if (count_true_lanes((counter_vec_t)(count1 >= overflow_count - count0)) > 0) {
+      // At least one sum would not fit in a small counter.
+      for (size_t i = 0; i < counter_lanes; i++)
+        add_count(pos + i, other->count_at(pos + i));
       continue;
-    if (count0 != 0) {
-      byte_counter[pos] = count1;
-      bytes_touched++;
     }
-    else
-      byte_counter[pos] = (count1 > bf_max_bytecount - count0) ? bf_max_bytecount : count0 + count1;
+    bytes_touched += count_true_lanes((counter_vec_t)((count0 == 0) & (count1 != 0)));
+    count0 += count1;
+    memcpy(&small_counter[pos], &count0, sizeof(count0));
+  }
+  for (; pos < logical_page_size; pos++)
+    add_count(pos, other->count_at(pos));
+  widen_if_crowded();
+}
+
+// Fill a page-sized bit mask with one bit per touched byte.
+void WordPageTableEntry::touched_bits(uint64_t* bits) const
+{
+  for (size_t w = 0; w < logical_page_size/64; w++) {
+    uint64_t word = 0;
+    for (size_t b = 0; b < 64; b++)
+      word |= uint64_t(count_at(w*64 + b) != 0) << b;
+    bits[w] = word;
   }
 }
 
@@ -24,6 +24,7 @@ protected:
 public:
   // Store the logical page size.
   BasePageTableEntry(size_t pg_size) : logical_page_size(pg_size) { }
+  virtual ~BasePageTableEntry() { }
 
   // Return the number of bytes that were accessed.
   size_t count() const {
@@ -47,18 +48,75 @@ public:
   // Merge the counts from another BitPageTableEntry into ours.
   void merge(BitPageTableEntry* other);
 
+  // Mark as touched each byte whose bit is set in a page-sized bit mask.
+  void mark(const uint64_t* bits);
+
+  // Fill a page-sized bit mask with one bit per touched byte.
+  void touched_bits(uint64_t* bits) const;
+
+  // Return the number of bytes of memory used by the entry.
+  size_t bytes_used() const {
+    return sizeof(*this) + (bit_vector ? logical_page_size/8 : 0);
+  }
+
   // Define a constructor, copy constructor, and destructor.
   BitPageTableEntry(size_t pg_size);
   BitPageTableEntry(const BitPageTableEntry& other);
   ~BitPageTableEntry();
 };
 
-// Specialize BasePageTableEntry for word-sized counters.
+// Allocate storage for page-table counters.  By default, storage comes from
+// the heap.  Once configured with a directory, storage instead comes from a
+// shared mapping of a sparse temporary file in that directory, which grows
+// in chunks and gains disk blocks only when first touched.  Whenever the
+// storage handed out since the last trim exceeds a resident-memory limit,
+// every chunk is written back and dropped from memory, to be faulted back in
+// on demand.  Counters thus spill to disk instead of exhausting memory.  All
+// methods are thread-safe.
+class PageArena {
+public:
+  // Back all subsequent allocations with a temporary file (which is unlinked
+  // immediately) in a given directory and keep roughly at most
+  // resident_limit bytes in memory.
+  static void configure(const char* dirname, uint64_t resident_limit);
+
+  // Allocate a block of memory.
+  static void* allocate(size_t bytes);
+
+  // Release a block of memory returned by allocate().
+  static void release(void* ptr, size_t bytes);
+};
+
+// Specialize BasePageTableEntry for word-sized counters.  To save memory,
+// each byte's counter is initially stored in only 8 bits.  The few counters
+// that reach overflow_count instead keep their full-width count in a sparse
+// table.  If too many counters overflow, the page switches to storing a
+// full-width counter for every byte.
 class WordPageTableEntry : public BasePageTableEntry {
 private:
-  bytecount_t* byte_counter;      // One counter per byte on the page
+  uint8_t* small_counter;               // One small counter per byte on the page, or nullptr
+  FlatAddrMap<bytecount_t>* overflow;   // Full counts of bytes whose small counter overflowed
+  bytecount_t* wide_counter;            // One full-width counter per byte, or nullptr
+
+  // Add to the tally of a single byte, clamping at the maximum word value.
+  void add_count(size_t pos, bytecount_t count);
+
+  // Switch from small to full-width counters.
+  void widen();
+
+  // Increment the full-width tallies associated with a range of bytes.
+  void increment_wide(size_t pos1, size_t pos2);
+
+  // Switch to full-width counters if the overflow table has grown too large.
+  void widen_if_crowded() {
+    if (overflow != nullptr && overflow->size() > logical_page_size/8)
+      widen();
+  }
 
 public:
+  // Small-counter value indicating that a byte's count lives in overflow
+  static const uint8_t overflow_count = 255;
+
   // Increment the tallies associated with a range of bytes, clamping each at
   // the maximum word value.
   void increment(size_t pos1, size_t pos2);
@@ -66,8 +124,24 @@ public:
   // Merge the counts from another WordPageTableEntry into ours.
   void merge(WordPageTableEntry* other);
 
-  // Expose the raw counts.
-  bytecount_t* raw_counts() { return byte_counter; }
+  // Fill a page-sized bit mask with one bit per touched byte.
+  void touched_bits(uint64_t* bits) const;
+
+  // Return the tally associated with a given byte.
+  bytecount_t count_at(size_t pos) const {
+    if (wide_counter != nullptr)
+      return wide_counter[pos];
+    uint8_t count = small_counter[pos];
+    return count == overflow_count ? overflow->find(pos)->second : count;
+  }
+
+  // Return the number of bytes of memory used by the entry.
+  size_t bytes_used() const {
+    if (wide_counter != nullptr)
+      return sizeof(*this) + logical_page_size*sizeof(bytecount_t);
+    return sizeof(*this) + logical_page_size
+      + (overflow ? sizeof(*overflow) + overflow->bytes_used() : 0);
+  }
 
   // Define a constructor, copy constructor, and destructor.
   WordPageTableEntry(size_t pg_size);
@@ -75,91 +149,275 @@ public:
   ~WordPageTableEntry();
 };
 
-// Define a page table that associates a counter with each byte of program
-// memory.
+// Map page numbers to page-table entries using a flat hash table.  This
+// suits sparse page tables, which touch only a few pages apiece.
 template<typename PTE>
-class PageTable {
+class HashPageMap {
 private:
-  // Define an equality functors for use in constructing various hash tables.
-  struct eqaddr {
-    bool operator()(uintptr_t p1, uintptr_t p2) const { return p1 == p2; }
-  };
+  typedef FlatAddrMap<PTE*> page_to_PTE_t;
+  page_to_PTE_t mapping;
+
+public:
+  HashPageMap(size_t) { }
+
+  // Expose iterators over {page number, PTE} pairs.
+  typedef typename page_to_PTE_t::iterator iterator;
+  iterator begin() { return mapping.begin(); }
+  iterator end() { return mapping.end(); }
+
+  // Return the PTE for a given page number or nullptr if there is none.
+  PTE* find (uint64_t pagenum) {
+    auto iter = mapping.find(pagenum);
+    return iter == mapping.end() ? nullptr : iter->second;
+  }
+
+  // Associate a new PTE with a given page number.
+  void insert (uint64_t pagenum, PTE* pte) {
+    mapping[pagenum] = pte;
+  }
+
+  // Return the number of bytes of memory used by the mapping itself.
+  size_t bytes_used() const { return mapping.bytes_used(); }
+};
+
+// Map page numbers to page-table entries using a four-level, direct-indexed
+// radix tree, as a hardware page table does.  Looking up a page costs four
+// dependent loads and no hashing, and the most recently used page is cached.
+// The tree covers 48-bit addresses; pages beyond that range, if any, are
+// kept in a hash table instead.
+template<typename PTE>
+class RadixPageMap {
+private:
+  static const unsigned address_bits = 48;  // Bits of address covered by the tree
+  static const unsigned upper_bits = 9;     // Index bits per non-leaf level
+  static const unsigned upper_levels = 3;   // Number of non-leaf levels
+  typedef void* node_t;                     // Child node or, in a leaf, a PTE*
+  unsigned leaf_bits;                       // Index bits in a leaf node
+  uint64_t covered_pages;                   // Number of page numbers the tree covers
+  node_t* root;                             // Top level of the tree
+  size_t num_nodes[upper_levels + 1];       // Number of nodes allocated per level
+  uint64_t last_pagenum;                    // Page number most recently found
+  PTE* last_pte;                            // PTE most recently found
+  FlatAddrMap<PTE*> overflow;               // Pages the tree does not cover
+
+  // Keep a list of every page so that iteration need not walk the tree.
+  typedef vector<pair<uint64_t, PTE*> > page_list_t;
+  page_list_t all_pages;
+
+  // Return the number of entries in a node at a given level.
+  size_t node_entries (unsigned level) const {
+    return size_t(1) << (level == upper_levels ? leaf_bits : upper_bits);
+  }
+
+  // Return a page number's index into a node at a given level.
+  size_t node_index (uint64_t pagenum, unsigned level) const {
+    if (level == upper_levels)
+      return pagenum & ((uint64_t(1) << leaf_bits) - 1);
+    unsigned shift = leaf_bits + (upper_levels - 1 - level)*upper_bits;
+    return (pagenum >> shift) & ((uint64_t(1) << upper_bits) - 1);
+  }
+
+  // Allocate an empty node for a given level.
+  node_t* new_node (unsigned level) {
+    num_nodes[level]++;
+    return new node_t[node_entries(level)]();
+  }
 
+  // Free a node and all of its descendants (but not the PTEs).
+  void free_node (node_t* node, unsigned level) {
+    if (level < upper_levels)
+      for (size_t i = 0; i < node_entries(level); i++)
+        if (node[i] != nullptr)
+          free_node((node_t*)node[i], level + 1);
+    delete[] node;
+  }
+
+public:
+  RadixPageMap(size_t pg_size) : root(nullptr), last_pagenum(~uint64_t(0)), last_pte(nullptr) {
+    unsigned page_bits = 0;
+    while ((size_t(2) << page_bits) <= pg_size)
+      page_bits++;
+    if (address_bits > page_bits + upper_levels*upper_bits)
+      leaf_bits = address_bits - page_bits - upper_levels*upper_bits;
+    else
+      leaf_bits = 1;
+    covered_pages = uint64_t(1) << (leaf_bits + upper_levels*upper_bits);
+    for (unsigned level = 0; level <= upper_levels; level++)
+      num_nodes[level] = 0;
+  }
+
+  ~RadixPageMap() {
+    if (root != nullptr)
+      free_node(root, 0);
+  }
+
+  // Expose iterators over {page number, PTE} pairs.
+  typedef typename page_list_t::iterator iterator;
+  iterator begin() { return all_pages.begin(); }
+  iterator end() { return all_pages.end(); }
+
+  // Return the PTE for a given page number or nullptr if there is none.
+  PTE* find (uint64_t pagenum) {
+    if (pagenum == last_pagenum)
+      return last_pte;
+    PTE* pte = nullptr;
+    if (__builtin_expect(pagenum >= covered_pages, 0)) {
+      auto iter = overflow.find(pagenum);
+      if (iter != overflow.end())
+        pte = iter->second;
+    }
+    else {
+      node_t* node = root;
+      for (unsigned level = 0; level < upper_levels && node != nullptr; level++)
+        node = (node_t*)node[node_index(pagenum, level)];
+      if (node != nullptr)
+        pte = (PTE*)node[node_index(pagenum, upper_levels)];
+    }
+    if (pte != nullptr) {
+      last_pagenum = pagenum;
+      last_pte = pte;
+    }
+    return pte;
+  }
+
+  // Associate a new PTE with a given page number.
+  void insert (uint64_t pagenum, PTE* pte) {
+    all_pages.push_back(make_pair(pagenum, pte));
+    if (__builtin_expect(pagenum >= covered_pages, 0)) {
+      overflow[pagenum] = pte;
+      return;
+    }
+    if (root == nullptr)
+      root = new_node(0);
+    node_t* node = root;
+    for (unsigned level = 0; level < upper_levels; level++) {
+      node_t& child = node[node_index(pagenum, level)];
+      if (child == nullptr)
+        child = new_node(level + 1);
+      node = (node_t*)child;
+    }
+    node[node_index(pagenum, upper_levels)] = pte;
+  }
+
+  // Return the number of bytes of memory used by the mapping itself.
+  size_t bytes_used() const {
+    size_t bytes = all_pages.capacity()*sizeof(typename page_list_t::value_type)
+      + overflow.bytes_used();
+    for (unsigned level = 0; level <= upper_levels; level++)
+      bytes += num_nodes[level]*node_entries(level)*sizeof(node_t);
+    return bytes;
+  }
+};
+
+// Define a page table that associates a counter with each byte of program
+// memory.  The PageMap parameter selects how page numbers are mapped to
+// page-table entries.
+template<typename PTE, template<typename> class PageMap = RadixPageMap>
+class PageTable {
+private:
   // Define a mapping from a page number to the associated PageTableEntry.
-  typedef CachedUnorderedMap<uintptr_t, PTE*, hash<uintptr_t>, eqaddr> page_to_PTE_t;
+  typedef PageMap<PTE> page_to_PTE_t;
   page_to_PTE_t mapping;
 
   // Logical page size in bytes represented
   size_t logical_page_size;
 
-  // Given a mapping of page numbers to counter vectors and a page number,
-  // return a counter vector, creating it if not found.
-  PTE* find_or_create_page (page_to_PTE_t& mapping, uint64_t pagenum) {
-    auto counters_iter = mapping.find(pagenum);
-    if (counters_iter == mapping.end()) {
+  // Given a page number, return a counter vector, creating it if not found.
+  PTE* find_or_create_page (uint64_t pagenum) {
+    PTE* counters = mapping.find(pagenum);
+    if (counters == nullptr) {
       // This is the first byte we've touched on the page.
-      mapping[pagenum] = new PTE(logical_page_size);
-      return mapping[pagenum];
+      counters = new PTE(logical_page_size);
+      mapping.insert(pagenum, counters);
     }
-    else
-      // We've seen other bytes on this page.
-      return counters_iter->second;
+    return counters;
   }
 
 public:
   // Store the logical page size.
-  PageTable(size_t pg_size) : logical_page_size(pg_size) { }
+  PageTable(size_t pg_size) : mapping(pg_size), logical_page_size(pg_size) { }
+
+  // Free every page-table entry.  Entries are owned by exactly one table, so
+  // tables cannot be copied.
+  ~PageTable() {
+    for (auto page_iter = mapping.begin(); page_iter != mapping.end(); page_iter++)
+      delete page_iter->second;
+  }
+  PageTable(const PageTable&) = delete;
+  PageTable& operator= (const PageTable&) = delete;
 
   // Expose iterators to our underlying address-to-PTE mapping.
   typename page_to_PTE_t::iterator begin() { return mapping.begin(); }
   typename page_to_PTE_t::iterator end() { return mapping.end(); }
 
-  // Increment each counter in a given range.
-  void access (uint64_t baseaddr, uint64_t numaddrs) {
+  // Increment each counter in a given range.  Return the number of bytes
+  // in the range that had never before been accessed.
+  uint64_t access (uint64_t baseaddr, uint64_t numaddrs) {
     uint64_t first_page = baseaddr / logical_page_size;
     uint64_t last_page = (baseaddr + numaddrs - 1) / logical_page_size;
+    uint64_t new_bytes = 0;
     if (first_page == last_page) {
       // Common case (we hope) -- all addresses lie on the same logical page.
-      PTE* counters = find_or_create_page(mapping, first_page);
+      PTE* counters = find_or_create_page(first_page);
       uint64_t pagebase = baseaddr % logical_page_size;
+      size_t old_count = counters->count();
       counters->increment(pagebase, pagebase + numaddrs - 1);
+      new_bytes = counters->count() - old_count;
     }
     else
-      // Less common case -- addresses may span logical pages.
-      for (uint64_t i = 0; i < numaddrs; i++) {
-        uint64_t address = baseaddr + i;
-        uint64_t pagenum = address / logical_page_size;
-        uint64_t byteoffset = address % logical_page_size;
-        PTE* counters = find_or_create_page(mapping, pagenum);
-        counters->increment(byteoffset, byteoffset);
+      // Less common case -- addresses span logical pages.  Mark each page's
+      // portion of the range in bulk.
+      for (uint64_t pagenum = first_page; pagenum <= last_page; pagenum++) {
+        uint64_t pos1 = pagenum == first_page ? baseaddr % logical_page_size : 0;
+        uint64_t pos2 = pagenum == last_page
+          ? (baseaddr + numaddrs - 1) % logical_page_size
+          : logical_page_size - 1;
+        PTE* counters = find_or_create_page(pagenum);
+        size_t old_count = counters->count();
+        counters->increment(pos1, pos2);
+        new_bytes += counters->count() - old_count;
       }
+    return new_bytes;
   }
 
-  // Merge another page table into ours.
-  void merge (PageTable<PTE>* other) {
-    // Ensure we have a superset of the other page table's pages.
-    for (auto page_iter = other->mapping.begin();
-         page_iter != other->mapping.end();
-         page_iter++) {
-      uint64_t page_num = page_iter->first;
-      if (mapping.find(page_num) != mapping.end())
-        continue;
-      mapping[page_num] = new PTE(logical_page_size);
-    }
+  // Merge another page table, possibly with a different mapping, into ours.
+  template<template<typename> class OtherPageMap>
+  void merge (PageTable<PTE, OtherPageMap>* other) {
+    for (auto page_iter = other->begin(); page_iter != other->end(); page_iter++)
+      find_or_create_page(page_iter->first)->merge(page_iter->second);
+  }
 
-    // Merge page-by-page.
-    for (auto page_iter = mapping.begin();
-         page_iter != mapping.end();
-         page_iter++) {
-      uint64_t page_num = page_iter->first;
-      auto other_page_iter = other->mapping.find(page_num);
-      if (other_page_iter == other->mapping.end())
-        continue;
-      BitPageTableEntry* pte = other_page_iter->second;
-      page_iter->second->merge(pte);
+  // Merge another page table into ours as above, and additionally mark in a
+  // bit page table each byte that both tables touched.
+  template<template<typename> class OtherPageMap>
+  void merge (PageTable<PTE, OtherPageMap>* other, PageTable<BitPageTableEntry>* shared) {
+    vector<uint64_t> our_bits(logical_page_size/64);
+    vector<uint64_t> their_bits(logical_page_size/64);
+    for (auto page_iter = other->begin(); page_iter != other->end(); page_iter++) {
+      PTE* counters = mapping.find(page_iter->first);
+      if (counters != nullptr) {
+        counters->touched_bits(our_bits.data());
+        page_iter->second->touched_bits(their_bits.data());
+        uint64_t any_bits = 0;
+        for (size_t w = 0; w < our_bits.size(); w++) {
+          our_bits[w] &= their_bits[w];
+          any_bits |= our_bits[w];
+        }
+        if (any_bits != 0)
+          shared->mark(page_iter->first, our_bits.data());
+      }
+      else
+        counters = find_or_create_page(page_iter->first);
+      counters->merge(page_iter->second);
     }
   }
 
+  // Mark as touched each byte of a given page whose bit is set in a
+  // page-sized bit mask.
+  void mark (uint64_t pagenum, const uint64_t* bits) {
+    find_or_create_page(pagenum)->mark(bits);
+  }
+
   // Return the number of unique addresses accessed.
   uint64_t tally_unique (void) {
     uint64_t unique_addrs = 0;
@@ -171,11 +429,25 @@ public:
     }
     return unique_addrs;
   }
+
+  // Return the number of bytes of memory used by the page table, including
+  // all of its page-table entries.
+  uint64_t bytes_used (void) {
+    uint64_t bytes = sizeof(*this) + mapping.bytes_used();
+    for (auto page_iter = mapping.begin();
+         page_iter != mapping.end();
+         page_iter++)
+      bytes += page_iter->second->bytes_used();
+    return bytes;
+  }
 };
 
 // For convenience, define concrete BitPageTable and WordPageTable classes.
+// SparseBitPageTable is intended for the many small page tables that each
+// touch only a few pages.
 typedef PageTable<BitPageTableEntry> BitPageTable;
 typedef PageTable<WordPageTableEntry> WordPageTable;
+typedef PageTable<BitPageTableEntry, HashPageMap> SparseBitPageTable;
 
 } // namespace bytesflops
 
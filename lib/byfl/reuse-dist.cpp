@@ -6,241 +6,213 @@
  *    Rob Aulwes <rta@lanl.gov>
  */
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include "byfl.h"
+#include "reuse-dist.h"
 
 using namespace std;
 
 namespace bytesflops {
 
-typedef CachedUnorderedMap<uint64_t, uint64_t> addr_to_time_t;
-addr_to_time_t last_access;   // Last access time of a given address
+const RDindex RDnodePool::null_node;
+const RDindex RDnodePool::splay_header;
 
-// An RDnode is one node in a reuse-distance tree.
-class RDnode {
-private:
-  RDnode* left;         // Left child
-  RDnode* right;        // Right child
-
-  // Fix the node's weight (subtree size).
-  void fix_node_weight();
-
-  // Fix the weight of all nodes along the path to a given time.
-  void fix_path_weights(uint64_t time);
-
-  // Splay a value to the top of the tree, returning the new tree.
-  RDnode* splay(uint64_t target);
-
-public:
-  uint64_t address;     // Address from trace
-  uint64_t time;        // Time of the address's last access
-  uint64_t weight;      // Number of items in this subtree (self included)
-
-  // Initialize a new RDnode with a given address and timestamp (defaulting to
-  // dummy values).
-  RDnode();
-  RDnode(uint64_t address, uint64_t time);
-
-  // Reinitialize an existing RDnode with a given address and timestamp.
-  void initialize(uint64_t address, uint64_t time);
-
-  // Insert a node into the tree and return the new tree.
-  RDnode* insert(RDnode* new_node);
-
-  // Remove a timestamp from the tree and return the new tree and the node that
-  // was deleted.
-  RDnode* remove(uint64_t timestamp, RDnode** removed_node);
-
-  // Remove all timestamps less than a given value from the tree and from a
-  // given histogram, and return the new tree.
-  RDnode* prune_tree(uint64_t timestamp, addr_to_time_t* histogram);
-
-  // Return the number of nodes in a splay tree whose timestamp is larger than
-  // a given value.
-  uint64_t tree_dist(uint64_t timestamp);
-
-  // Ensure that all nodes have a valid weight.
-  void validate_weights();
-};
+// Reserve the null node and the splay header so that neither is ever handed
+// out.  The null node's fields are never meaningfully read, but its child
+// indices point back to itself so that stray reads remain harmless.
+RDnodePool::RDnodePool(const char* owner_name, const char* overflow_advice)
+{
+  nodes.resize(2, RDnode{0, 0, null_node, null_node, 0});
+  free_list = null_node;
+  owner = owner_name;
+  advice = overflow_advice;
+}
 
 // fix_node_weight() sets the weight of a given node to the sum of its
 // immediate children's weight plus one.
-void RDnode::fix_node_weight()
+void RDnodePool::fix_node_weight(RDindex idx)
 {
-  uint64_t new_weight = 1;
-  if (left != nullptr)
-    new_weight += left->weight;
-  if (right != nullptr)
-    new_weight += right->weight;
-  weight = new_weight;
+  RDnode& node = node_at(idx);
+  uint32_t new_weight = 1;
+  if (node.left != null_node)
+    new_weight += node_at(node.left).weight;
+  if (node.right != null_node)
+    new_weight += node_at(node.right).weight;
+  node.weight = new_weight;
 }
 
 
 // fix_path_weights() fixes node weights along the path to a given time.
-void RDnode::fix_path_weights(uint64_t target)
+void RDnodePool::fix_path_weights(RDindex tree, uint64_t target)
 {
   // Do an ordinary binary tree search for target -- which we expect not to
-  // find -- but change child pointers to parent pointers as we go (instead of
+  // find -- but change child indices to parent indices as we go (instead of
   // requiring extra memory to maintain our path back to the root).
-  RDnode* parent = nullptr;
-  RDnode* node = this;
-  while (node != nullptr) {
-    RDnode* child;
-    if (target < node->time) {
-      child = node->left;
-      node->left = parent;
+  RDindex parent = null_node;
+  RDindex node = tree;
+  while (node != null_node) {
+    RDindex child;
+    if (target < node_at(node).time) {
+      child = node_at(node).left;
+      node_at(node).left = parent;
     }
     else {
-      child = node->right;
-      node->right = parent;
+      child = node_at(node).right;
+      node_at(node).right = parent;
     }
     parent = node;
     node = child;
   }
 
-  // Walk back up the tree, fixing weights and child pointers as we go.
-  while (parent != nullptr) {
-    RDnode* prev_node = node;
+  // Walk back up the tree, fixing weights and child indices as we go.
+  while (parent != null_node) {
+    RDindex prev_node = node;
     node = parent;
-    if (target < node->time) {
-      // We borrowed our left child's pointer.
-      parent = node->left;
-      node->left = prev_node;
+    if (target < node_at(node).time) {
+      // We borrowed our left child's index.
+      parent = node_at(node).left;
+      node_at(node).left = prev_node;
     }
     else {
-      // We borrowed our right child's pointer.
-      parent = node->right;
-      node->right = prev_node;
+      // We borrowed our right child's index.
+      parent = node_at(node).right;
+      node_at(node).right = prev_node;
     }
-    node->fix_node_weight();
+    fix_node_weight(node);
   }
 }
 
 
 // splay() splays a value (or a nearby value if the value doesn't appear in the
 // tree) to the top of the tree, returning the new tree.
-RDnode* RDnode::splay(uint64_t target)
+RDindex RDnodePool::splay(RDindex tree, uint64_t target)
 {
-  RDnode* node = this;
-  RDnode new_node;
-  new_node.left = nullptr;
-  new_node.right = nullptr;
-  RDnode* left = &new_node;
-  RDnode* right = &new_node;
+  RDindex node = tree;
+  node_at(splay_header).left = null_node;
+  node_at(splay_header).right = null_node;
+  RDindex left = splay_header;
+  RDindex right = splay_header;
 
   while (true) {
-    if (target < node->time) {
-      if (node->left == nullptr)
+    if (target < node_at(node).time) {
+      if (node_at(node).left == null_node)
         break;
-      if (target < node->left->time) {
+      if (target < node_at(node_at(node).left).time) {
         // Rotate right
-        RDnode* parent = node->left;
-        node->left = parent->right;
-        parent->right = node;
+        RDindex parent = node_at(node).left;
+        node_at(node).left = node_at(parent).right;
+        node_at(parent).right = node;
         node = parent;
 
         // Fix weights.
-        node->right->fix_node_weight();
-        node->fix_node_weight();
-        if (node->left == nullptr)
+        fix_node_weight(node_at(node).right);
+        fix_node_weight(node);
+        if (node_at(node).left == null_node)
           break;
       }
 
       // Link right
-      right->left = node;
+      node_at(right).left = node;
       right = node;
-      node = node->left;
+      node = node_at(node).left;
     }
     else
-      if (target > node->time) {
-        if (node->right == nullptr)
+      if (target > node_at(node).time) {
+        if (node_at(node).right == null_node)
           break;
-        if (target > node->right->time) {
+        if (target > node_at(node_at(node).right).time) {
           // Rotate left
-          RDnode* parent = node->right;
-          node->right = parent->left;
-          parent->left = node;
+          RDindex parent = node_at(node).right;
+          node_at(node).right = node_at(parent).left;
+          node_at(parent).left = node;
           node = parent;
 
           // Fix weights.
-          node->left->fix_node_weight();
-          node->fix_node_weight();
-          if (node->right == nullptr)
+          fix_node_weight(node_at(node).left);
+          fix_node_weight(node);
+          if (node_at(node).right == null_node)
             break;
         }
 
         // Link left
-        left->right = node;
+        node_at(left).right = node;
         left = node;
-        node = node->right;
+        node = node_at(node).right;
       }
       else
         break;
   }
 
   // Assemble the final tree.
-  left->right = node->left;
-  right->left = node->right;
-  node->left = new_node.right;
-  node->right = new_node.left;
+  node_at(left).right = node_at(node).left;
+  node_at(right).left = node_at(node).right;
+  node_at(node).left = node_at(splay_header).right;
+  node_at(node).right = node_at(splay_header).left;
 
   // Fix weights up to the node from its previous position.
-  node->left->fix_path_weights(node->time);
-  node->right->fix_path_weights(node->time);
+  fix_path_weights(node_at(node).left, node_at(node).time);
+  fix_path_weights(node_at(node).right, node_at(node).time);
   return node;
 }
 
 // insert() inserts a new node into a splay tree and returns the new tree.
-// Duplicates insertions produce undefined behavior.  Insertions into NULL
-// trees produce undefined behavior.  (The caller should check for the
-// first-insertion and allocate memory accordingly.)
-RDnode* RDnode::insert(RDnode* new_node)
+// Duplicate insertions abort the program.
+RDindex RDnodePool::insert(RDindex tree, RDindex new_node)
 {
   // Handle some simple cases.
-  RDnode* node = this;
-  node = node->splay(new_node->time);
-  if (new_node->time == node->time)
+  if (tree == null_node)
+    // The new node is the entire tree.
+    return new_node;
+  RDindex node = splay(tree, node_at(new_node).time);
+  if (node_at(new_node).time == node_at(node).time)
     // The timestamp is already in the tree.  This should never happen when the
     // tree is used for reuse-distance calculations.
     abort();
 
   // Handle the normal cases.
-  if (new_node->time > node->time) {
-    new_node->right = node->right;
-    new_node->left = node;
-    node->right = nullptr;
+  if (node_at(new_node).time > node_at(node).time) {
+    node_at(new_node).right = node_at(node).right;
+    node_at(new_node).left = node;
+    node_at(node).right = null_node;
   }
   else {
-    new_node->left = node->left;
-    new_node->right = node;
-    node->left = nullptr;
+    node_at(new_node).left = node_at(node).left;
+    node_at(new_node).right = node;
+    node_at(node).left = null_node;
   }
-  node->fix_node_weight();
-  new_node->fix_node_weight();
+  fix_node_weight(node);
+  fix_node_weight(new_node);
   return new_node;
 }
 
 
 // remove() deletes a timestamp from the tree and returns the new tree and the
-// deleted node.  Missing timestamps produce undefined behavior.
-RDnode* RDnode::remove(uint64_t target, RDnode** removed_node)
+// deleted node.  Missing timestamps abort the program.
+RDindex RDnodePool::remove(RDindex tree, uint64_t target, RDindex* removed_node)
 {
-  RDnode* node = this;
-  node = node->splay(target);
-  if (node->time != target)
+  if (tree == null_node)
+    // Empty tree
+    abort();
+  RDindex node = splay(tree, target);
+  if (node_at(node).time != target)
     // Not found
     abort();
-  RDnode* new_root;
-  if (node->left == nullptr)
+  RDindex new_root;
+  if (node_at(node).left == null_node)
     // Smallest value in the tree
-    new_root = node->right;
+    new_root = node_at(node).right;
   else {
     // Any other value
-    new_root = node->left->splay(target);
-    if (new_root != nullptr) {
-      new_root->right = node->right;
-      if (new_root->right != nullptr)
-        new_root->right->fix_node_weight();
-      new_root->fix_node_weight();
+    new_root = splay(node_at(node).left, target);
+    if (new_root != null_node) {
+      node_at(new_root).right = node_at(node).right;
+      if (node_at(new_root).right != null_node)
+        fix_node_weight(node_at(new_root).right);
+      fix_node_weight(new_root);
     }
   }
   *removed_node = node;
@@ -249,17 +221,19 @@ RDnode* RDnode::remove(uint64_t target, RDnode** removed_node)
 
 
 // Remove all timestamps less than a given value from the tree and from a given
-// histogram, and return the new tree and new set of symbols.
-RDnode* RDnode::prune_tree(uint64_t timestamp, addr_to_time_t* histogram)
-{
-  RDnode* new_tree = splay(0);
-  while (new_tree && new_tree->time < timestamp) {
-    RDnode* dead_node = new_tree;
-    new_tree = new_tree->right;
-    if (new_tree->left)
-      new_tree = new_tree->splay(0);
-    histogram->erase(dead_node->address);
-    delete dead_node;
+// histogram, and return the new tree.  The removed nodes are recycled.
+RDindex RDnodePool::prune_tree(RDindex tree, uint64_t timestamp, addr_to_time_t* histogram)
+{
+  if (tree == null_node)
+    return null_node;
+  RDindex new_tree = splay(tree, 0);
+  while (new_tree != null_node && node_at(new_tree).time < timestamp) {
+    RDindex dead_node = new_tree;
+    new_tree = node_at(new_tree).right;
+    if (new_tree != null_node && node_at(new_tree).left != null_node)
+      new_tree = splay(new_tree, 0);
+    histogram->erase(node_at(dead_node).address);
+    release(dead_node);
   }
   return new_tree;
 }
@@ -267,72 +241,91 @@ RDnode* RDnode::prune_tree(uint64_t timestamp, addr_to_time_t* histogram)
 
 // tree_dist() returns the number of nodes in a splay tree whose timestamp is
 // larger than a given value.
-uint64_t RDnode::tree_dist(uint64_t timestamp)
+uint64_t RDnodePool::tree_dist(RDindex tree, uint64_t timestamp)
 {
-  RDnode* node = this;
+  RDindex node = tree;
   uint64_t num_larger = 0;
-  while (true) {
-    if (timestamp > node->time) {
-      node = node->right;
+  while (node != null_node) {
+    const RDnode& info = node_at(node);
+    if (timestamp > info.time) {
+      node = info.right;
     }
     else
-      if (timestamp < node->time) {
+      if (timestamp < info.time) {
         num_larger++;
-        if (node->right != nullptr)
-          num_larger += node->right->weight;
-        node = node->left;
+        if (info.right != null_node)
+          num_larger += node_at(info.right).weight;
+        node = info.left;
       }
       else {
-        if (node->right != nullptr)
-          num_larger += node->right->weight;
+        if (info.right != null_node)
+          num_larger += node_at(info.right).weight;
         return num_larger;
       }
   }
+  return num_larger;
 }
 
 
 // For debugging purposes, ensure that every node of a tree contains correct
 // weights.
-void RDnode::validate_weights()
+void RDnodePool::validate_weights(RDindex tree)
 {
   uint64_t true_weight = 1;
-  if (left != nullptr) {
-    left->validate_weights();
-    true_weight += left->weight;
+  const RDnode& node = node_at(tree);
+  if (node.left != null_node) {
+    validate_weights(node.left);
+    true_weight += node_at(node.left).weight;
   }
-  if (right != nullptr) {
-    right->validate_weights();
-    true_weight += right->weight;
+  if (node.right != null_node) {
+    validate_weights(node.right);
+    true_weight += node_at(node.right).weight;
   }
-  if (weight != true_weight) {
-    cerr << "*** Internal error: Node " << this << " has weight "
-         << weight << " but expected weight " << true_weight << " ***\n";
+  if (node.weight != true_weight) {
+    cerr << "*** Internal error: Node " << tree << " has weight "
+         << node.weight << " but expected weight " << true_weight << " ***\n";
     abort();
   }
 }
 
-// Reinitialize an existing RDnode with a given address and timestamp.
-void RDnode::initialize(uint64_t new_address, uint64_t new_time)
+// Reinitialize an existing node with a given address and timestamp.
+void RDnodePool::initialize(RDindex idx, uint64_t new_address, uint64_t new_time)
 {
-  address = new_address;
-  time = new_time;
-  weight = 1;
-  left = nullptr;
-  right = nullptr;
+  RDnode& node = node_at(idx);
+  node.address = new_address;
+  node.time = new_time;
+  node.weight = 1;
+  node.left = null_node;
+  node.right = null_node;
 }
 
 
-// Initialize a new RDnode with a dummy address and timestamp.
-RDnode::RDnode()
+// Return a node with a given address and timestamp, preferring one from the
+// free list to growing the pool.
+RDindex RDnodePool::allocate(uint64_t address, uint64_t time)
 {
-  initialize(0, 0);
+  RDindex idx = free_list;
+  if (idx != null_node)
+    free_list = node_at(idx).left;
+  else {
+    if (nodes.size() > uint64_t(~RDindex(0))) {
+      cerr << owner << " exceeded " << uint64_t(~RDindex(0))
+           << " nodes; consider " << advice << "\n";
+      bf_abend();
+    }
+    idx = RDindex(nodes.size());
+    nodes.push_back(RDnode());
+  }
+  initialize(idx, address, time);
+  return idx;
 }
 
 
-// Initialize a new RDnode with a given address and timestamp.
-RDnode::RDnode(uint64_t address, uint64_t time)
+// Put a node on the free list.
+void RDnodePool::release(RDindex idx)
 {
-  initialize(address, time);
+  node_at(idx).left = free_list;
+  free_list = idx;
 }
 
 
@@ -340,142 +333,711 @@ RDnode::RDnode(uint64_t address, uint64_t time)
 const uint64_t infinite_distance = ~(uint64_t)0;
 
 
+// Begin with a single empty block so that insert() always has a newest block
+// to compare against.
+ApproxRDtree::ApproxRDtree(double error)
+{
+  blocks.push_back(RDblock{0, 0});
+  fenwick.resize(2, 0);
+  total = 0;
+  max_error = error;
+  compress_at = 1024;
+}
+
+
+// Add a value to the count of a given block in the binary indexed tree.
+void ApproxRDtree::fenwick_add(size_t idx, int64_t delta)
+{
+  for (size_t i = idx + 1; i < fenwick.size(); i += i & -i)
+    fenwick[i] += delta;
+}
+
+
+// Return the sum of the counts of blocks 0 through idx-1.
+uint64_t ApproxRDtree::fenwick_prefix(size_t idx)
+{
+  uint64_t sum = 0;
+  for (size_t i = idx; i > 0; i -= i & -i)
+    sum += fenwick[i];
+  return sum;
+}
+
+
+// Merge blocks from newest to oldest.  A run of blocks may be merged as long
+// as half its count minus one, rounded up, is at most the relative error
+// times the number of timestamps newer than the run.  Blocks that end before
+// the horizon are discarded.  The binary indexed tree is rebuilt afterwards.
+void ApproxRDtree::compress(uint64_t horizon)
+{
+  // Discard blocks that lie entirely before the horizon.
+  size_t first = 0;
+  while (first + 1 < blocks.size() && blocks[first + 1].first_time <= horizon) {
+    total -= blocks[first].count;
+    first++;
+  }
+
+  // Merge blocks, newest first.
+  vector<RDblock> merged;
+  uint64_t newer = 0;   // Timestamps newer than the current run
+  RDblock run = blocks.back();
+  for (size_t i = blocks.size() - 1; i > first; i--) {
+    const RDblock& prev = blocks[i - 1];
+    if (run.count + prev.count <= 1 + 2*uint64_t(max_error*double(newer))) {
+      run.first_time = prev.first_time;
+      run.count += prev.count;
+    }
+    else {
+      merged.push_back(run);
+      newer += run.count;
+      run = prev;
+    }
+  }
+  merged.push_back(run);
+  blocks.assign(merged.rbegin(), merged.rend());
+
+  // Rebuild the binary indexed tree in linear time.
+  fenwick.assign(blocks.size() + 1, 0);
+  for (size_t i = 1; i < fenwick.size(); i++) {
+    fenwick[i] += blocks[i - 1].count;
+    size_t parent = i + (i & -i);
+    if (parent < fenwick.size())
+      fenwick[parent] += fenwick[i];
+  }
+  compress_at = max(blocks.size()*2, size_t(1024));
+}
+
+
+// Insert a timestamp newer than all others as a block of its own.
+void ApproxRDtree::insert(uint64_t time, uint64_t horizon)
+{
+  if (blocks.size() >= compress_at)
+    compress(horizon);
+  blocks.push_back(RDblock{time, 1});
+  total++;
+
+  // Initialize the new entry of the binary indexed tree from the counts it
+  // covers.
+  size_t i = blocks.size();
+  size_t low = i - (i & -i);
+  fenwick.push_back(1 + fenwick_prefix(i - 1) - fenwick_prefix(low));
+}
+
+
+// Remove a timestamp and estimate its distance as the number of timestamps in
+// newer blocks plus half of the other timestamps in its own block.
+uint64_t ApproxRDtree::remove(uint64_t time)
+{
+  if (time < blocks.front().first_time)
+    return infinite_distance;
+  auto next_block = upper_bound(blocks.begin(), blocks.end(), time,
+                                [](uint64_t t, const RDblock& b) {
+                                  return t < b.first_time;
+                                });
+  size_t idx = (next_block - blocks.begin()) - 1;
+  RDblock& block = blocks[idx];
+  uint64_t newer = total - fenwick_prefix(idx + 1);
+  uint64_t distance = newer + (block.count - 1)/2;
+  block.count--;
+  fenwick_add(idx, -1);
+  total--;
+  return distance;
+}
+
+
+// Compute the median of a histogram of reuse distances and the median
+// absolute deviation of that.  Both are computed from the histogram's bins,
+// taking each bin's midpoint as the distance of every access it contains,
+// and consider only accesses with a finite reuse distance.
+static void histogram_median(const HdrHistogram& hist,
+                             uint64_t* median_value, uint64_t* mad_value)
+{
+  // Find the total tally.
+  size_t num_bins = hist.size();   // Bins in the histogram
+  uint64_t total_tally = 0;        // Total number of reuses
+  for (size_t bin = 0; bin < num_bins; bin++)
+    total_tally += hist[bin];
+  if (total_tally == 0) {
+    *median_value = infinite_distance;
+    *mad_value = infinite_distance;
+    return;
+  }
+
+  // Find the distance that lies at half the total tally.
+  uint64_t median_distance = 0;
+  uint64_t median_tally = 0;
+  for (size_t bin = 0; bin < num_bins; bin++) {
+    median_tally += hist[bin];
+    if (median_tally > total_tally/2) {
+      median_distance = hist.bin_min(bin) + (hist.bin_max(bin) - hist.bin_min(bin))/2;
+      break;
+    }
+  }
+
+  // Tally the absolute deviations.
+  vector<pair<uint64_t, uint64_t> > absdev;   // {deviation, tally} pairs
+  for (size_t bin = 0; bin < num_bins; bin++) {
+    uint64_t tally = hist[bin];
+    if (tally == 0)
+      continue;
+    uint64_t dist = hist.bin_min(bin) + (hist.bin_max(bin) - hist.bin_min(bin))/2;
+    uint64_t deviation;
+    if (dist > median_distance)
+      deviation = dist - median_distance;
+    else
+      deviation = median_distance - dist;
+    absdev.push_back(make_pair(deviation, tally));
+  }
+  sort(absdev.begin(), absdev.end());
+
+  // Find the deviation that lies at half the total tally.
+  uint64_t mad = 0;
+  uint64_t absdev_tally = 0;
+  for (auto iter = absdev.cbegin(); iter != absdev.cend(); iter++) {
+    mad = iter->first;
+    absdev_tally += iter->second;
+    if (absdev_tally > total_tally/2)
+      break;
+  }
+
+  // Return the results.
+  *median_value = median_distance;
+  *mad_value = mad;
+}
+
+
 // A ReuseDistance encapsulates all the state needed for a
 // reuse-distance calculation.
 class ReuseDistance {
 private:
   uint64_t clock;           // Current time
-  vector<uint64_t> hist;    // Histogram of the number of times each reuse distance was observed
+  addr_to_time_t last_access;  // Last access time of a given address
+  HdrHistogram hist;        // Histogram of the number of times each reuse distance was observed
   uint64_t unique_entries;  // Number of unique addresses (infinite reuse distance)
-  RDnode* dist_tree;        // Tree of reuse distances
+  RDnodePool pool;          // Storage for the tree's nodes
+  RDindex dist_tree;        // Tree of reuse distances
+  uint64_t max_entries;     // Number of sampled addresses to retain before pruning
+  uint64_t total_addrs;     // Number of addresses seen, whether or not sampled
+  uint64_t log2_granularity;  // log base 2 of the number of bytes per address
+  ApproxRDtree* approx_tree;  // Approximate replacement for dist_tree, if any
+
+  // The following are used only when reporting reuse distance per window.
+  uint64_t window_length;   // Memory accesses per window (0=time-based)
+  double window_seconds;    // Seconds per window (0=access-based)
+  uint64_t num_accesses;    // Memory accesses seen so far
+  uint64_t window_start;    // Value of num_accesses when the window began
+  chrono::steady_clock::time_point first_time;   // Time of the first access
+  chrono::steady_clock::time_point window_time;  // Time the window began
+  HdrHistogram window_hist; // Reuse distances observed during the window
+  uint64_t window_unique;   // Unique addresses first seen during the window
+  vector<ReuseWindow> windows;  // All completed windows
+
+  // Tally a reuse distance in the histogram.
+  void tally_distance(uint64_t distance);
+
+  // Close the current window if it has reached its length.
+  void check_window();
+
+  // Incorporate a new address into the reuse-distance histogram using the
+  // approximate tree, and return its reuse distance.
+  uint64_t process_address_approx(uint64_t address);
 
 public:
   // Initialize our various fields.
-  ReuseDistance() {
+  ReuseDistance() :
+    hist(unsigned(bf_reuse_bin_bits)),
+    window_hist(unsigned(bf_reuse_bin_bits)) {
     clock = 0;
     unique_entries = 0;
-    dist_tree = nullptr;
+    dist_tree = RDnodePool::null_node;
+    // Retain at least the most recent address, or a maximum reuse distance
+    // smaller than the sample period would prune every address on arrival.
+    max_entries = bf_max_reuse_distance/bf_sample_period;
+    if (max_entries == 0)
+      max_entries = 1;
+    total_addrs = 0;
+    log2_granularity = 0;
+    for (uint64_t gran = bf_reuse_granularity; gran > 1; gran >>= 1)
+      log2_granularity++;
+    if (bf_reuse_error_ppm > 0)
+      approx_tree = new ApproxRDtree(bf_reuse_error_ppm/1.0e6);
+    else
+      approx_tree = nullptr;
+    window_length = 0;
+    window_seconds = 0.0;
+    num_accesses = 0;
+    window_start = 0;
+    window_unique = 0;
   }
 
-  // Incorporate a new address into the reuse-distance histogram.
-  void process_address(uint64_t address);
+  // Report reuse distance for each window of a given number of memory
+  // accesses or a given number of seconds.
+  void set_window(uint64_t accesses, double seconds) {
+    window_length = accesses;
+    window_seconds = seconds;
+  }
+
+  // Record the current window, if nonempty, and begin a new one.
+  void close_window();
+
+  // Return all completed windows.
+  const vector<ReuseWindow>& get_windows() { return windows; }
+
+  // Incorporate a range of bytes into the reuse-distance histogram as the
+  // distinct granules they span, skipping those not admitted by spatial
+  // sampling.  If a function histogram is given, also tally each finite
+  // distance there.
+  void process_addresses(uint64_t baseaddr, uint64_t numaddrs,
+                         HdrHistogram* func_hist=nullptr);
+
+  // Incorporate a new address into the reuse-distance histogram, and return
+  // its reuse distance.
+  uint64_t process_address(uint64_t address);
 
   // Return a pointer to the reuse-distance histogram.
-  vector<uint64_t>* get_histogram() { return &hist; }
+  HdrHistogram* get_histogram() { return &hist; }
 
   // Return the number of unique addresses.
   uint64_t get_unique_addrs() { return unique_entries; }
 
+  // Return the number of addresses processed and the number seen.
+  uint64_t get_sampled_addrs() { return clock; }
+  uint64_t get_total_addrs() { return total_addrs; }
+
   // Compute the median reuse distance.
   void compute_median(uint64_t* median_value, uint64_t* mad_value);
 };
 
 
-// Incorporate a new address into the reuse-distance histogram.
-void ReuseDistance::process_address(uint64_t address)
+// Tally a reuse distance in the histogram.
+void ReuseDistance::tally_distance(uint64_t distance)
 {
+  if (distance == infinite_distance) {
+    // This is the first time we've seen this symbol.
+    unique_entries++;
+    window_unique++;
+  }
+  else {
+    // We've previously seen this symbol.
+    hist.increment(distance);
+    if (window_length > 0 || window_seconds > 0.0)
+      window_hist.increment(distance);
+  }
+}
+
+
+// Incorporate a new address into the reuse-distance histogram, and return
+// its reuse distance.
+uint64_t ReuseDistance::process_address(uint64_t address)
+{
+  if (approx_tree != nullptr)
+    return process_address_approx(address);
+
   // Update the histogram.
   uint64_t distance = infinite_distance;
   addr_to_time_t::iterator prev_time_iter = last_access.find(address);
-  RDnode* new_node = nullptr;
+  RDindex new_node = RDnodePool::null_node;
   if (prev_time_iter != last_access.end()) {
     // We've previously seen this address.
     uint64_t prev_time = prev_time_iter->second;
-    distance = dist_tree->tree_dist(prev_time);
-    dist_tree = dist_tree->remove(prev_time, &new_node);
-  }
-  uint64_t hist_len = hist.size();
-  if (distance < hist_len)
-    // We've previously seen both this symbol and this reuse distance.
-    hist[distance]++;
-  else {
-    if (distance == infinite_distance)
-      // This is the first time we've seen this symbol.
-      unique_entries++;
-    else {
-      // We've previously seen this symbol but not this reuse distance.
-      hist.resize(distance+1, 0);
-      hist[distance]++;
-    }
+    distance = pool.tree_dist(dist_tree, prev_time);
+    dist_tree = pool.remove(dist_tree, prev_time, &new_node);
+    prev_time_iter->second = clock;
   }
+  else
+    last_access[address] = clock;
+  tally_distance(distance);
 
   // Update the tree and the map.
-  if (new_node == nullptr)
-    new_node = new RDnode(address, clock);
+  if (new_node == RDnodePool::null_node)
+    new_node = pool.allocate(address, clock);
   else
-    new_node->initialize(address, clock);
-  if (__builtin_expect(dist_tree == nullptr, 0))
-    // First insertion into the tree.
-    dist_tree = new_node;
-  else
-    // All other tree insertions.
-    dist_tree = dist_tree->insert(new_node);
-  last_access[address] = clock;
+    pool.initialize(new_node, address, clock);
+  dist_tree = pool.insert(dist_tree, new_node);
   clock++;
 
   // If the tree and the map have grown too large, prune old addresses from
   // them.
-  if (last_access.size() > bf_max_reuse_distance)
-    dist_tree = dist_tree->prune_tree(clock - bf_max_reuse_distance, &last_access);
+  if (last_access.size() > max_entries)
+    dist_tree = pool.prune_tree(dist_tree, clock - max_entries, &last_access);
+  return distance;
+}
+
+
+// Incorporate a new address into the reuse-distance histogram, estimating
+// its distance with the approximate tree.  Because the approximate tree does
+// not know which addresses it discards, addresses last seen more than
+// max_entries accesses ago are treated as new.  At most max_entries addresses
+// can be that recent, so whenever the map holds twice that many it is swept
+// of the rest, which keeps it bounded at amortized constant cost.
+uint64_t ReuseDistance::process_address_approx(uint64_t address)
+{
+  uint64_t distance = infinite_distance;
+  addr_to_time_t::iterator prev_time_iter = last_access.find(address);
+  if (prev_time_iter != last_access.end()) {
+    // We've previously seen this address.
+    uint64_t prev_time = prev_time_iter->second;
+    distance = approx_tree->remove(prev_time);
+    if (clock - prev_time > max_entries)
+      distance = infinite_distance;
+    prev_time_iter->second = clock;
+  }
+  else
+    last_access[address] = clock;
+  tally_distance(distance);
+  approx_tree->insert(clock, clock > max_entries ? clock - max_entries : 0);
+  clock++;
+  if (last_access.size()/2 > max_entries) {
+    vector<uint64_t> stale;
+    for (auto iter = last_access.begin(); iter != last_access.end(); iter++)
+      if (clock - iter->second > max_entries)
+        stale.push_back(iter->first);
+    for (auto iter = stale.begin(); iter != stale.end(); iter++)
+      last_access.erase(*iter);
+  }
+  return distance;
+}
+
+
+// Incorporate a range of bytes into the reuse-distance histogram.  At a
+// granularity of more than one byte, an "address" is a granule number, and
+// each granule is processed once per access no matter how many of its bytes
+// are touched.
+void ReuseDistance::process_addresses(uint64_t baseaddr, uint64_t numaddrs,
+                                      HdrHistogram* func_hist)
+{
+  if (numaddrs == 0)
+    return;
+  uint64_t first = baseaddr >> log2_granularity;
+  uint64_t last = (baseaddr + numaddrs - 1) >> log2_granularity;
+  total_addrs += last - first + 1;
+  for (uint64_t address = first; address <= last; address++)
+    if (bf_sample_admits(address)) {
+      uint64_t distance = process_address(address);
+      if (func_hist != nullptr && distance != infinite_distance)
+        func_hist->increment(distance);
+    }
+  if (window_length > 0 || window_seconds > 0.0)
+    check_window();
+}
+
+
+// Close the current window if it has reached its length.  Time-based windows
+// consult the clock only every 1024 accesses.
+void ReuseDistance::check_window()
+{
+  if (__builtin_expect(num_accesses == 0, 0)) {
+    first_time = chrono::steady_clock::now();
+    window_time = first_time;
+  }
+  num_accesses++;
+  if (window_length > 0) {
+    if (num_accesses - window_start >= window_length)
+      close_window();
+  }
+  else
+    if ((num_accesses & 1023) == 0) {
+      chrono::duration<double> elapsed = chrono::steady_clock::now() - window_time;
+      if (elapsed.count() >= window_seconds)
+        close_window();
+    }
+}
+
+
+// Record the current window, if nonempty, and begin a new one.
+void ReuseDistance::close_window()
+{
+  if (num_accesses == window_start)
+    return;
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  ReuseWindow window;
+  window.first_access = window_start;
+  window.num_accesses = num_accesses - window_start;
+  window.start_usecs = chrono::duration_cast<chrono::microseconds>(window_time - first_time).count();
+  window.duration_usecs = chrono::duration_cast<chrono::microseconds>(now - window_time).count();
+  window.unique_addrs = window_unique;
+  histogram_median(window_hist, &window.median, &window.mad);
+  for (size_t bin = 0; bin < window_hist.size(); bin++)
+    if (window_hist[bin] > 0)
+      window.bins.push_back(make_tuple(window_hist.bin_min(bin),
+                                       window_hist.bin_max(bin),
+                                       window_hist[bin]));
+  windows.push_back(window);
+
+  // Begin a new window.
+  window_hist.reset();
+  window_unique = 0;
+  window_start = num_accesses;
+  window_time = now;
 }
 
 
 // Compute the median reuse distance and the median absolute deviation of that.
 void ReuseDistance::compute_median(uint64_t* median_value, uint64_t* mad_value) {
-  // Find the total tally.
-  uint64_t hist_len = hist.size();   // Entries in the histogram
-  uint64_t total_tally;              // Total number of accesses including one-time accesses
-  total_tally = unique_entries - hist_len;
-  for (size_t dist = 0; dist < hist_len; dist++)
-    total_tally += hist[dist];
+  histogram_median(hist, median_value, mad_value);
+}
 
-  // Find the distance that lies at half the total tally.
-  uint64_t median_distance = infinite_distance;
-  uint64_t median_tally = 0;
-  for (size_t dist = 0; dist < hist_len; dist++) {
-    median_distance = dist;
-    median_tally += hist[dist];
-    if (median_tally > total_tally/2)
-      break;
-  }
 
-  // Tally the absolute deviations.
-  vector<uint64_t> absdev(hist_len, 0);
-  for (size_t dist = 0; dist < hist_len; dist++) {
-    uint64_t tally = hist[dist];
-    uint64_t deviation;
-    if (dist > median_distance)
-      deviation = dist - median_distance;
-    else
-      deviation = median_distance - dist;
-    absdev[deviation] += tally;
+// A ReuseLog is a single-producer, single-consumer queue of one thread's
+// memory accesses, each stamped with the time it was logged.  The consumer
+// merges all threads' logs in timestamp order to compute the shared view of
+// reuse distance.
+class ReuseLog {
+public:
+  struct Entry {
+    uint64_t time;        // Nanoseconds on the steady clock
+    uint64_t baseaddr;    // First address accessed
+    uint64_t numaddrs;    // Number of bytes accessed
+  };
+
+  ReuseLog() {
+    head = tail = new Block();
+    head_pos = 0;
   }
 
-  // Find the deviation that lies at half the total tally.
-  uint64_t mad = 0;
-  uint64_t absdev_tally = 0;
-  uint64_t absdev_len = absdev.size();
-  for (size_t dev = 0; dev < absdev_len; dev++) {
-    mad = dev;
-    absdev_tally += absdev[dev];
-    if (absdev_tally > total_tally/2)
-      break;
+  // Append an access to the log.  Called only by the owning thread.
+  void push(uint64_t time, uint64_t baseaddr, uint64_t numaddrs);
+
+  // Return the oldest published entry, or nullptr if there is none.  Called
+  // only by the consumer.
+  const Entry* front();
+
+  // Discard the entry front() returned.  Called only by the consumer.
+  void pop() { head_pos++; }
+
+private:
+  struct Block {
+    static const size_t capacity = 4096;
+    Entry entries[capacity];
+    atomic<size_t> count;   // Number of entries the producer has published
+    atomic<Block*> next;    // Next block, once this one is full
+    Block() : count{0}, next{nullptr} { }
+  };
+  Block* head;         // Block the consumer is reading (consumer only)
+  size_t head_pos;     // Next entry the consumer will read (consumer only)
+  Block* tail;         // Block the producer is writing (producer only)
+};
+
+
+// Append an access to the log.
+void ReuseLog::push(uint64_t time, uint64_t baseaddr, uint64_t numaddrs)
+{
+  size_t pos = tail->count.load(memory_order_relaxed);
+  if (pos == Block::capacity) {
+    Block* block = new Block();
+    tail->next.store(block, memory_order_release);
+    tail = block;
+    pos = 0;
   }
+  tail->entries[pos] = Entry{time, baseaddr, numaddrs};
+  tail->count.store(pos + 1, memory_order_release);
+}
 
-  // Return the results.
-  *median_value = median_distance;
-  *mad_value = mad;
+
+// Return the oldest published entry, advancing past exhausted blocks.
+const ReuseLog::Entry* ReuseLog::front()
+{
+  while (true) {
+    if (head_pos < head->count.load(memory_order_acquire))
+      return &head->entries[head_pos];
+    if (head_pos < Block::capacity)
+      return nullptr;
+    Block* next = head->next.load(memory_order_acquire);
+    if (next == nullptr)
+      return nullptr;
+    delete head;
+    head = next;
+    head_pos = 0;
+  }
 }
 
 
 // Keep track of the reuse distance of the program as a whole.
 static ReuseDistance* global_reuse_dist = nullptr;
 
+// Keep track of the reuse distances attributed to each function or call
+// stack.  These are binned from the distances global_reuse_dist computes
+// rather than computed by a separate tree per function.
+static key2hist_t* func_reuse_hists = nullptr;
+
+// The following are used only when each thread computes its own (private)
+// reuse distance.  Each thread also logs its accesses, and a consumer thread
+// merges the logs by timestamp into global_reuse_dist, which then represents
+// the shared view of all threads' accesses.  Accesses logged within
+// log_grace_ns of the present are left for a later merge in case an older
+// access has yet to be published.
+struct ThreadReuse {
+  ReuseDistance reuse_dist;   // This thread's private reuse distance
+  key2hist_t func_hists;      // This thread's per-function histograms
+  ReuseLog log;               // This thread's accesses, for the shared view
+};
+static const uint64_t log_grace_ns = 1000000;
+static bool per_thread_reuse = false;
+static __thread ThreadReuse* thread_reuse = nullptr;
+static vector<ThreadReuse*>* all_thread_reuse = nullptr;  // protected by thread_reuse_mutex
+static mutex thread_reuse_mutex;
+static thread* reuse_consumer = nullptr;
+static atomic<bool> stop_reuse_consumer{false};
+static atomic<bool> reuse_threads_finished{false};  // true=update the shared view directly
+static HdrHistogram* private_hist = nullptr;   // Sum of all threads' histograms
+
+
+// Return the current time in nanoseconds.
+static inline uint64_t reuse_log_time (void)
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Feed global_reuse_dist, in timestamp order, every logged access older than
+// a given time, and return the number of accesses consumed.
+static uint64_t merge_reuse_logs (const vector<ThreadReuse*>& threads, uint64_t before)
+{
+  typedef pair<uint64_t, size_t> time_thread_t;   // {timestamp, thread index}
+  priority_queue<time_thread_t, vector<time_thread_t>, greater<time_thread_t> > oldest;
+  for (size_t t = 0; t < threads.size(); t++) {
+    const ReuseLog::Entry* entry = threads[t]->log.front();
+    if (entry != nullptr && entry->time < before)
+      oldest.push(make_pair(entry->time, t));
+  }
+  uint64_t consumed = 0;
+  while (!oldest.empty()) {
+    size_t t = oldest.top().second;
+    oldest.pop();
+    ReuseLog& log = threads[t]->log;
+    const ReuseLog::Entry* entry = log.front();
+    global_reuse_dist->process_addresses(entry->baseaddr, entry->numaddrs);
+    log.pop();
+    consumed++;
+    entry = log.front();
+    if (entry != nullptr && entry->time < before)
+      oldest.push(make_pair(entry->time, t));
+  }
+  return consumed;
+}
+
+
+// Merge every thread's log into the shared view until told to stop, then
+// merge whatever remains.
+static void consume_reuse_logs (void)
+{
+  vector<ThreadReuse*> threads;
+  bool stopping;
+  do {
+    stopping = stop_reuse_consumer.load(memory_order_acquire);
+    {
+      lock_guard<mutex> guard(thread_reuse_mutex);
+      threads = *all_thread_reuse;
+    }
+    uint64_t before = stopping ? ~uint64_t(0) : reuse_log_time() - log_grace_ns;
+    if (merge_reuse_logs(threads, before) == 0 && !stopping)
+      this_thread::sleep_for(chrono::microseconds(100));
+  } while (!stopping);
+}
+
+
+// Stop the consumer thread after it has merged every logged access, make all
+// later accesses update the shared view directly, then sum all threads'
+// private histograms and fold their per-function histograms into
+// func_reuse_hists.  Because a thread may log an access just as the consumer
+// stops, every call also merges the logs synchronously.
+static void finish_reuse_threads (void)
+{
+  if (!per_thread_reuse)
+    return;
+  thread* consumer;
+  bool first_call;
+  {
+    lock_guard<mutex> guard(thread_reuse_mutex);
+    first_call = !reuse_threads_finished.load(memory_order_relaxed);
+    reuse_threads_finished.store(true, memory_order_release);
+    consumer = reuse_consumer;
+    reuse_consumer = nullptr;
+  }
+  if (consumer != nullptr) {
+    stop_reuse_consumer.store(true, memory_order_release);
+    consumer->join();
+    delete consumer;
+  }
+  lock_guard<mutex> guard(thread_reuse_mutex);
+  merge_reuse_logs(*all_thread_reuse, ~uint64_t(0));
+  if (!first_call)
+    return;
+  for (auto titer = all_thread_reuse->begin(); titer != all_thread_reuse->end(); titer++) {
+    ThreadReuse* tr = *titer;
+    *private_hist += *tr->reuse_dist.get_histogram();
+    for (auto fiter = tr->func_hists.begin(); fiter != tr->func_hists.end(); fiter++) {
+      HdrHistogram*& func_hist = (*func_reuse_hists)[fiter->first];
+      if (func_hist == nullptr)
+        func_hist = new HdrHistogram(unsigned(bf_reuse_bin_bits));
+      *func_hist += *fiter->second;
+    }
+  }
+}
+
+
+// Process the reuse distance of a set of addresses relative to the calling
+// thread and log the access for the shared view.  If a function histogram
+// key is given, attribute the private distances to that key.  Once the
+// consumer has stopped, update the shared view directly instead of logging.
+static void process_thread_addresses (uint64_t baseaddr, uint64_t numaddrs,
+                                      const KeyType_t* key)
+{
+  if (__builtin_expect(thread_reuse == nullptr, 0)) {
+    thread_reuse = new ThreadReuse();
+    lock_guard<mutex> guard(thread_reuse_mutex);
+    all_thread_reuse->push_back(thread_reuse);
+    if (reuse_consumer == nullptr && !reuse_threads_finished.load(memory_order_relaxed))
+      reuse_consumer = new thread(consume_reuse_logs);
+  }
+  HdrHistogram* func_hist = nullptr;
+  if (key != nullptr) {
+    HdrHistogram*& hist = thread_reuse->func_hists[*key];
+    if (hist == nullptr)
+      hist = new HdrHistogram(unsigned(bf_reuse_bin_bits));
+    func_hist = hist;
+  }
+  thread_reuse->reuse_dist.process_addresses(baseaddr, numaddrs, func_hist);
+  if (__builtin_expect(reuse_threads_finished.load(memory_order_acquire), 0)) {
+    lock_guard<mutex> guard(thread_reuse_mutex);
+    global_reuse_dist->process_addresses(baseaddr, numaddrs);
+    return;
+  }
+  thread_reuse->log.push(reuse_log_time(), baseaddr, numaddrs);
+}
+
 
 // Initialize some of our variables at first use.
 void initialize_reuse (void)
 {
   global_reuse_dist = new ReuseDistance();
+  func_reuse_hists = new key2hist_t();
+
+  // Let the user report reuse distance per window of either a number of
+  // memory accesses or, with an "s" suffix, a number of seconds.
+  const char* window = getenv("BF_REUSE_WINDOW");
+  if (window != nullptr && strcmp(window, "") != 0) {
+    char* suffix;
+    double length = strtod(window, &suffix);
+    if (length <= 0.0
+        || (strcmp(suffix, "") == 0 && length < 1.0)
+        || (strcmp(suffix, "") != 0 && strcmp(suffix, "s") != 0)) {
+      cerr << "BF_REUSE_WINDOW must be a positive number of accesses or a positive number of seconds followed by \"s\"\n";
+      bf_abend();
+    }
+    if (*suffix == 's')
+      global_reuse_dist->set_window(0, length);
+    else
+      global_reuse_dist->set_window(uint64_t(length), 0.0);
+  }
+
+  // Let the user compute reuse distance per thread, with the shared view
+  // computed asynchronously from per-thread logs.
+  const char* threads = getenv("BF_REUSE_THREADS");
+  if (threads != nullptr && strcmp(threads, "") != 0 && strcmp(threads, "0") != 0) {
+    per_thread_reuse = true;
+    all_thread_reuse = new vector<ThreadReuse*>();
+    private_hist = new HdrHistogram(unsigned(bf_reuse_bin_bits));
+  }
 }
 
 
@@ -484,26 +1046,105 @@ void initialize_reuse (void)
 extern "C"
 void bf_reuse_dist_addrs_prog (uint64_t baseaddr, uint64_t numaddrs)
 {
-  if (bf_suppress_counting)
+  if (bf_suppress_counting || numaddrs == 0)
     return;
-  for (uint64_t ofs = 0; ofs < numaddrs; ofs++)
-    global_reuse_dist->process_address(baseaddr + ofs);
+  if (per_thread_reuse)
+    process_thread_addresses(baseaddr, numaddrs, nullptr);
+  else
+    global_reuse_dist->process_addresses(baseaddr, numaddrs);
+}
+
+
+// Process the reuse distance of a set of addresses relative to the
+// program as a whole, and attribute the distances to the given function
+// (or to the current call stack).  When reuse distance is computed per
+// thread, the distances attributed are the private ones.
+extern "C"
+void bf_reuse_dist_addrs_func (KeyType_t funcID, uint64_t baseaddr, uint64_t numaddrs)
+{
+  if (bf_suppress_counting || numaddrs == 0)
+    return;
+  KeyType_t key = bf_call_stack ? bf_func_and_parents_id : funcID;
+  if (per_thread_reuse) {
+    process_thread_addresses(baseaddr, numaddrs, &key);
+    return;
+  }
+  HdrHistogram*& func_hist = (*func_reuse_hists)[key];
+  if (func_hist == nullptr)
+    func_hist = new HdrHistogram(unsigned(bf_reuse_bin_bits));
+  global_reuse_dist->process_addresses(baseaddr, numaddrs, func_hist);
 }
 
 
 // Return the reuse distance histogram and count of unique bytes for
-// the program as a whole.
-void bf_get_reuse_distance (vector<uint64_t>** hist, uint64_t* unique_addrs)
+// the program as a whole.  The histogram is unscaled and binned by
+// distance in granules, but the count of unique bytes is scaled up by the
+// sample period and the granularity.
+void bf_get_reuse_distance (HdrHistogram** hist, uint64_t* unique_addrs)
 {
+  finish_reuse_threads();
   *hist = global_reuse_dist->get_histogram();
-  *unique_addrs = global_reuse_dist->get_unique_addrs();
+  *unique_addrs = global_reuse_dist->get_unique_addrs()*bf_sample_period*bf_reuse_granularity;
 }
 
 
-// Compute the median reuse distance for the program as a whole.
+// Return the sum of all threads' private reuse-distance histograms and the
+// median private reuse distance in bytes (scaled up by the sample period).
+// Return false if reuse distance is not computed per thread.
+bool bf_get_private_reuse_distance (HdrHistogram** hist, uint64_t* median_value, uint64_t* mad_value)
+{
+  if (!per_thread_reuse)
+    return false;
+  finish_reuse_threads();
+  *hist = private_hist;
+  histogram_median(*private_hist, median_value, mad_value);
+  if (*median_value != infinite_distance) {
+    *median_value *= bf_sample_period*bf_reuse_granularity;
+    *mad_value *= bf_sample_period*bf_reuse_granularity;
+  }
+  return true;
+}
+
+
+// Return the per-function (or per-call-stack) reuse-distance histograms.
+// The histograms are unscaled and binned by distance in granules.
+key2hist_t& bf_get_reuse_distance_by_func (void)
+{
+  finish_reuse_threads();
+  return *func_reuse_hists;
+}
+
+
+// Return the reuse distances observed during each window of execution.  The
+// final, partial window is closed first.
+const vector<ReuseWindow>& bf_get_reuse_windows (void)
+{
+  finish_reuse_threads();
+  global_reuse_dist->close_window();
+  return global_reuse_dist->get_windows();
+}
+
+
+// Return the number of addresses sampled for reuse distance and the number
+// that were candidates for sampling.
+void bf_get_reuse_sampling (uint64_t* sampled_addrs, uint64_t* total_addrs)
+{
+  finish_reuse_threads();
+  *sampled_addrs = global_reuse_dist->get_sampled_addrs();
+  *total_addrs = global_reuse_dist->get_total_addrs();
+}
+
+
+// Compute the median reuse distance in bytes for the program as a whole,
+// scaled up by the sample period.
 void bf_get_median_reuse_distance (uint64_t* median_value, uint64_t* mad_value)
 {
+  finish_reuse_threads();
   global_reuse_dist->compute_median(median_value, mad_value);
+  if (*median_value != infinite_distance) {
+    *median_value *= bf_sample_period*bf_reuse_granularity;
+    *mad_value *= bf_sample_period*bf_reuse_granularity;
+  }
 }
 
 }
@@ -0,0 +1,148 @@
+/*
+ * Helper library for computing bytes:flops ratios
+ * (reuse-distance tree class declarations)
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ *    Rob Aulwes <rta@lanl.gov>
+ */
+
+#ifndef _REUSE_DIST_H_
+#define _REUSE_DIST_H_
+
+#include "byfl.h"
+
+using namespace std;
+
+namespace bytesflops {
+
+// Define a mapping from an address to the time of its most recent access.
+typedef FlatAddrMap<uint64_t> addr_to_time_t;
+
+// Nodes are referred to by their 32-bit index into an RDnodePool.
+typedef uint32_t RDindex;
+
+// An RDnode is one node in a reuse-distance tree.  The tree is a splay tree
+// keyed by timestamp in which each node additionally records the size of its
+// subtree.  This makes it an order-statistic tree: the number of timestamps
+// greater than a given timestamp can be computed in logarithmic time.
+struct RDnode {
+  uint64_t address;     // Address from trace
+  uint64_t time;        // Time of the address's last access
+  RDindex left;         // Left child
+  RDindex right;        // Right child
+  uint32_t weight;      // Number of items in this subtree (self included)
+};
+
+// An RDnodePool stores the nodes of any number of reuse-distance trees in a
+// single array, which keeps each tree compact in memory and lets children be
+// referenced by 32-bit indices instead of pointers.  Nodes removed from a
+// tree are recycled through a free list.  A tree is represented by the
+// index of its root, with null_node representing the empty tree.  A pool is
+// not thread-safe.
+class RDnodePool {
+private:
+  vector<RDnode> nodes;   // All nodes, including a few reserved ones
+  RDindex free_list;      // Nodes available for reuse, linked through left
+  const char* owner;      // What the trees represent, for error messages
+  const char* advice;     // Options that reduce the number of nodes needed
+
+  // Index of a scratch node used as the header during splaying
+  static const RDindex splay_header = 1;
+
+  RDnode& node_at(RDindex idx) { return nodes[idx]; }
+
+  // Fix the node's weight (subtree size).
+  void fix_node_weight(RDindex idx);
+
+  // Fix the weight of all nodes along the path to a given time.
+  void fix_path_weights(RDindex tree, uint64_t time);
+
+  // Splay a value to the top of the tree, returning the new tree.
+  RDindex splay(RDindex tree, uint64_t target);
+
+public:
+  // Index representing the absence of a node
+  static const RDindex null_node = 0;
+
+  // Name what the pool's trees represent and the options that let a
+  // program that overflows the pool need fewer nodes.
+  RDnodePool(const char* owner_name="Reuse-distance tree",
+             const char* overflow_advice="-bf-max-rdist or -bf-reuse-granularity");
+
+  // Return a node (new or recycled) with a given address and timestamp.
+  RDindex allocate(uint64_t address, uint64_t time);
+
+  // Return a node to the pool.
+  void release(RDindex idx);
+
+  // Reinitialize an existing node with a given address and timestamp.
+  void initialize(RDindex idx, uint64_t address, uint64_t time);
+
+  // Insert a node into the tree and return the new tree.
+  RDindex insert(RDindex tree, RDindex new_node);
+
+  // Remove a timestamp from the tree and return the new tree and the node that
+  // was deleted.
+  RDindex remove(RDindex tree, uint64_t timestamp, RDindex* removed_node);
+
+  // Remove all timestamps less than a given value from the tree and from a
+  // given histogram, release their nodes, and return the new tree.
+  RDindex prune_tree(RDindex tree, uint64_t timestamp, addr_to_time_t* histogram);
+
+  // Return the number of nodes in a splay tree whose timestamp is larger than
+  // a given value.
+  uint64_t tree_dist(RDindex tree, uint64_t timestamp);
+
+  // Ensure that all nodes have a valid weight.
+  void validate_weights(RDindex tree);
+};
+
+// An ApproxRDtree approximates a reuse-distance tree in the manner of a scale
+// tree.  Instead of one node per timestamp it keeps a sequence of blocks, each
+// covering a contiguous range of timestamps and counting the addresses whose
+// most recent access lies in that range.  Adjacent blocks are merged as long
+// as no block holds more than twice the given relative error times the number
+// of timestamps newer than the block.  Estimating a timestamp's distance as
+// the midpoint of its block therefore errs by no more than that fraction of
+// the true distance, and the number of blocks grows only logarithmically with
+// the number of addresses.
+class ApproxRDtree {
+private:
+  struct RDblock {
+    uint64_t first_time;  // Earliest timestamp the block covers
+    uint64_t count;       // Number of live timestamps within the block
+  };
+  vector<RDblock> blocks;    // All blocks in increasing order of time
+  vector<uint64_t> fenwick;  // Binary indexed tree of block counts (1-based)
+  uint64_t total;            // Number of live timestamps in all blocks
+  double max_error;          // Maximum relative error of a distance
+  size_t compress_at;        // Number of blocks at which to merge blocks
+
+  // Add a value to the count of a given block in the binary indexed tree.
+  void fenwick_add(size_t idx, int64_t delta);
+
+  // Return the sum of the counts of all blocks before a given block.
+  uint64_t fenwick_prefix(size_t idx);
+
+  // Merge blocks wherever the error bound allows, discarding blocks that lie
+  // entirely before a given timestamp.
+  void compress(uint64_t horizon);
+
+public:
+  ApproxRDtree(double error);
+
+  // Insert a timestamp newer than all others.  Timestamps before the
+  // horizon may be discarded.
+  void insert(uint64_t time, uint64_t horizon);
+
+  // Remove a timestamp and return an estimate of the number of timestamps
+  // larger than it, or ~0 if the timestamp has already been discarded.
+  uint64_t remove(uint64_t time);
+
+  // Return the relative error bound.
+  double get_max_error() { return max_error; }
+};
+
+} // namespace bytesflops
+
+#endif
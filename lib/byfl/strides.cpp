@@ -25,22 +25,23 @@ class AccessPattern {
 public:
   bf_symbol_info_t syminfo;             // Call-point source information
   uint64_t prev_addr;                   // Previous data address
+  int64_t prev_stride;                  // Previous byte stride (0 if none)
   uint64_t num_bytes;                   // Bytes per access (i.e., word size)
   uint64_t stride_tally[NUM_STRIDES];   // Tally by word stride
   uint64_t backward_strides;            // Tally of backward strides, any distance
   uint64_t total_strides;               // Sum across stride_tally[]
   bool is_store;                        // true=store; false=load
   bool is_const;                        // true=provably constant address at compile time; false=may vary
-  BitPageTable* touched_data;           // Flags for every byte of memory accessed
+  SparseBitPageTable* touched_data;     // Flags for every byte of memory accessed
 
   // Initialize an AccessPattern with all zero tallies.
   AccessPattern(bf_symbol_info_t sinfo, uint64_t addr, uint64_t nbytes,
                 bool st, bool cons) :
-    syminfo(sinfo), prev_addr(addr), num_bytes(nbytes),  backward_strides(0),
+    syminfo(sinfo), prev_addr(addr), prev_stride(0), num_bytes(nbytes),  backward_strides(0),
     total_strides(0), is_store(st), is_const(cons), touched_data(nullptr) {
     memset(stride_tally, 0, NUM_STRIDES*sizeof(uint64_t));
     if (bf_unique_bytes || bf_mem_footprint) {
-      touched_data = new BitPageTable(logical_page_size);
+      touched_data = new SparseBitPageTable(logical_page_size);
       touched_data->access(addr, nbytes);
     }
   }
@@ -123,6 +124,13 @@ void bf_track_stride (bf_symbol_info_t* syminfo, uint64_t baseaddr,
   // our information accordingly.
   AccessPattern* info = iter->second;
   info->increment_tally(baseaddr);
+
+  // When emulating a stride prefetcher, prefetch one stride ahead of any
+  // call point that repeats a nonzero stride.
+  int64_t stride = int64_t(baseaddr - info->prev_addr);
+  if (bf_cache_model && stride != 0 && stride == info->prev_stride)
+    bf_prefetch_stride(baseaddr, stride);
+  info->prev_stride = stride;
   info->prev_addr = baseaddr;
   if (info->touched_data != nullptr)
     info->touched_data->access(baseaddr, numaddrs);
@@ -155,6 +163,18 @@ void bf_partition_unique_addresses (uint64_t* uti, uint64_t *mti)
   *mti = mti_pt.tally_unique();
 }
 
+// Return the number of bytes of memory used by all call points' page tables.
+uint64_t bf_strides_memory (void)
+{
+  if (stride_data == nullptr)
+    return 0;
+  uint64_t bytes = 0;
+  for (auto iter = stride_data->begin(); iter != stride_data->end(); iter++)
+    if (iter->second->touched_data != nullptr)
+      bytes += iter->second->touched_data->bytes_used();
+  return bytes;
+}
+
 // This function is used by sort() to sort stride information in decreasing
 // order of the total number of strides observed.  Break ties using the
 // filename, then line number, and finally the instruction string, all in
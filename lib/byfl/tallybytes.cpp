@@ -6,6 +6,7 @@
  *    Rob Aulwes <rta@lanl.gov>
  */
 
+#include <mutex>
 #include "byfl.h"
 
 using namespace std;
@@ -18,19 +19,129 @@ typedef CachedUnorderedMap<const char*, WordPageTable*> func_to_page_t;
 static WordPageTable* global_unique_bytes = nullptr;
 static func_to_page_t* function_unique_bytes = nullptr;
 
+// When bf_unique_sketch_bits is nonzero, each function instead gets a
+// fixed-size HyperLogLog sketch that estimates its unique bytes.
+typedef CachedUnorderedMap<const char*, HyperLogLog*> func_to_sketch_t;
+static func_to_sketch_t* function_unique_sketches = nullptr;
+
 // Define a logical page size to use throughout this file.
 static const size_t logical_page_size = 8192;
 
+// The following are used only when each thread tracks the unique bytes it
+// touches in its own page table.  per_thread_tables is set before any thread
+// starts and never changes.  A thread's table is folded into
+// global_unique_bytes and freed when the thread exits or, for the thread
+// requesting results, when results are requested.  Any later accesses by
+// that thread go directly to global_unique_bytes.  thread_tables_mutex
+// protects global_unique_bytes and the variables below it.
+static bool per_thread_tables = false;
+static __thread WordPageTable* thread_unique_bytes = nullptr;
+static __thread size_t thread_number = 0;          // Index into thread_unique_tallies
+static __thread bool thread_table_folded = false;  // true=this thread's table was folded
+static mutex thread_tables_mutex;
+static vector<uint64_t>* thread_unique_tallies = nullptr;  // Unique bytes per thread
+static BitPageTable* shared_unique_bytes = nullptr;  // Bytes touched by more than one thread
+static uint64_t thread_tables_memory = 0;    // Bytes used by the per-thread tables
+
+// Fold the calling thread's page table into global_unique_bytes, recording
+// the thread's unique bytes and marking those that earlier threads also
+// touched, then free the table.
+static void fold_thread_table (void)
+{
+  WordPageTable* table = thread_unique_bytes;
+  thread_table_folded = true;
+  if (table == nullptr)
+    return;
+  thread_unique_bytes = nullptr;
+  lock_guard<mutex> guard(thread_tables_mutex);
+  (*thread_unique_tallies)[thread_number] = table->tally_unique();
+  thread_tables_memory += table->bytes_used();
+  global_unique_bytes->merge(table, shared_unique_bytes);
+  delete table;
+}
+
+// Fold each thread's page table when the thread exits.  The main thread's
+// is folded before any static destructor (and hence the final report) runs.
+struct TallyTableFolder {
+  ~TallyTableFolder() { fold_thread_table(); }
+};
+static thread_local TallyTableFolder thread_table_folder;
+
+// Give the calling thread a page table of its own.
+static void create_thread_table (void)
+{
+  (void) &thread_table_folder;    // Arrange for the table to be folded at thread exit.
+  thread_unique_bytes = new WordPageTable(logical_page_size);
+  lock_guard<mutex> guard(thread_tables_mutex);
+  thread_number = thread_unique_tallies->size();
+  thread_unique_tallies->push_back(0);
+}
+
 // Initialize some of our variables at first use.
 void initialize_tallybytes (void)
 {
+  // Let the user keep page-table counters in a file instead of in memory.
+  const char* pt_dir = getenv("BF_PAGE_TABLE_DIR");
+  if (pt_dir != nullptr && strcmp(pt_dir, "") != 0) {
+    uint64_t resident_limit = 0;
+    const char* resident = getenv("BF_PAGE_TABLE_RESIDENT");
+    if (resident != nullptr && strcmp(resident, "") != 0) {
+      char* suffix;
+      resident_limit = bf_parse_size(resident, &suffix);
+      if (*suffix != '\0') {
+        cerr << "BF_PAGE_TABLE_RESIDENT must be a number of bytes, optionally followed by K, M, or G\n";
+        bf_abend();
+      }
+    }
+    PageArena::configure(pt_dir, resident_limit);
+  }
+
   global_unique_bytes = new WordPageTable(logical_page_size);
   function_unique_bytes = new func_to_page_t();
+  function_unique_sketches = new func_to_sketch_t();
+
+  // Let the user track unique bytes in a separate page table per thread.
+  const char* threads = getenv("BF_UNIQUE_THREADS");
+  if (threads != nullptr && strcmp(threads, "") != 0 && strcmp(threads, "0") != 0) {
+    per_thread_tables = true;
+    thread_unique_tallies = new vector<uint64_t>();
+    shared_unique_bytes = new BitPageTable(logical_page_size);
+  }
+}
+
+// Fold the calling thread's page table into global_unique_bytes before
+// results are read.  Every other thread's table was folded when that thread
+// exited; tables of threads that are still running are not included.
+static void finish_thread_tables (void)
+{
+  if (per_thread_tables && !thread_table_folded)
+    fold_thread_table();
+}
+
+// Return the number of unique bytes each thread touched and the number of
+// bytes touched by more than one thread.  Return false if unique bytes are
+// not tracked per thread.
+bool bf_get_thread_unique_bytes_tb (vector<uint64_t>* per_thread, uint64_t* shared)
+{
+  if (!per_thread_tables)
+    return false;
+  finish_thread_tables();
+  lock_guard<mutex> guard(thread_tables_mutex);
+  *per_thread = *thread_unique_tallies;
+  *shared = shared_unique_bytes->tally_unique();
+  return true;
 }
 
 // Return the number of unique addresses referenced by a given function.
 uint64_t bf_tally_unique_addresses_tb (const char* funcname)
 {
+  if (bf_unique_sketch_bits > 0) {
+    func_to_sketch_t::iterator sketch_iter = function_unique_sketches->find(funcname);
+    if (sketch_iter == function_unique_sketches->end())
+      return 0;
+    else
+      return sketch_iter->second->estimate();
+  }
   func_to_page_t::iterator map_iter = function_unique_bytes->find(funcname);
   if (map_iter == function_unique_bytes->end())
     return 0;
@@ -41,9 +152,28 @@ uint64_t bf_tally_unique_addresses_tb (const char* funcname)
 // Return the number of unique addresses referenced by the entire program.
 uint64_t bf_tally_unique_addresses_tb (void)
 {
+  finish_thread_tables();
+  lock_guard<mutex> guard(thread_tables_mutex);
   return global_unique_bytes->tally_unique();
 }
 
+// Return the number of bytes of memory used by all of our page tables.
+uint64_t bf_unique_bytes_memory_tb (void)
+{
+  finish_thread_tables();
+  lock_guard<mutex> guard(thread_tables_mutex);
+  uint64_t bytes = global_unique_bytes->bytes_used() + thread_tables_memory;
+  for (auto map_iter = function_unique_bytes->begin();
+       map_iter != function_unique_bytes->end();
+       map_iter++)
+    bytes += map_iter->second->bytes_used();
+  for (auto sketch_iter = function_unique_sketches->begin();
+       sketch_iter != function_unique_sketches->end();
+       sketch_iter++)
+    bytes += sketch_iter->second->bytes_used();
+  return bytes;
+}
+
 // Associate a set of memory locations with a given function.  Return the
 // page-to-bit-vector mapping for the given function.
 static WordPageTable* assoc_addresses_with_func (const char* funcname,
@@ -62,13 +192,30 @@ static WordPageTable* assoc_addresses_with_func (const char* funcname,
   return unique_bytes;
 }
 
+// Associate a set of memory locations with a given function's sketch.
+static void assoc_addresses_with_sketch (const char* funcname,
+                                         uint64_t baseaddr,
+                                         uint64_t numaddrs)
+{
+  HyperLogLog* sketch;
+  func_to_sketch_t::iterator sketch_iter = function_unique_sketches->find(funcname);
+  if (sketch_iter == function_unique_sketches->end())
+    // This is the first time we've seen this function.
+    (*function_unique_sketches)[funcname] = sketch = new HyperLogLog(unsigned(bf_unique_sketch_bits),
+                                                                    bf_unique_sketch_granularity);
+  else
+    // We've seen this function before.
+    sketch = sketch_iter->second;
+  sketch->insert_range(baseaddr, numaddrs);
+}
+
 // Associate a set of memory locations with a given function.  This function
 // basically wraps assoc_addresses_with_func() with a quick cache lookup.
 extern "C"
 void bf_assoc_addresses_with_func_tb (const char* funcname, uint64_t baseaddr, uint64_t numaddrs)
 {
-  // Do nothing if counting is suppressed.
-  if (bf_suppress_counting)
+  // Do nothing if counting is suppressed or no bytes were accessed.
+  if (bf_suppress_counting || numaddrs == 0)
     return;
 
   // Find the given function's mapping from page number to bit list.
@@ -77,17 +224,33 @@ void bf_assoc_addresses_with_func_tb (const char* funcname, uint64_t baseaddr, u
   else
     funcname = bf_string_to_symbol(funcname);
 
-  // Associate the range of addresses with the function's page table.
-  assoc_addresses_with_func(funcname, baseaddr, numaddrs);
+  // Associate the range of addresses with the function's page table or
+  // sketch.
+  if (bf_unique_sketch_bits > 0)
+    assoc_addresses_with_sketch(funcname, baseaddr, numaddrs);
+  else
+    assoc_addresses_with_func(funcname, baseaddr, numaddrs);
 }
 
 // Associate a set of memory locations with the program as a whole.
 extern "C"
 void bf_assoc_addresses_with_prog_tb (uint64_t baseaddr, uint64_t numaddrs)
 {
-  if (bf_suppress_counting)
+  if (bf_suppress_counting || numaddrs == 0)
     return;
-  global_unique_bytes->access(baseaddr, numaddrs);
+  if (per_thread_tables) {
+    if (__builtin_expect(thread_unique_bytes == nullptr, 0)) {
+      if (thread_table_folded) {
+        lock_guard<mutex> guard(thread_tables_mutex);
+        global_unique_bytes->access(baseaddr, numaddrs);
+        return;
+      }
+      create_thread_table();
+    }
+    thread_unique_bytes->access(baseaddr, numaddrs);
+  }
+  else
+    bf_record_unique_growth(global_unique_bytes->access(baseaddr, numaddrs));
 }
 
 // Return true if one {count, multiplier} pair has a greater
@@ -110,10 +273,11 @@ static void get_address_tally_hist (WordPageTable& mapping, vector<bf_addr_tally
     counts_iter++;
 
     // Increment the multiplier for each count.
-    const bytecount_t* byte_counter = pte->raw_counts();
-    for (size_t i = 0; i < logical_page_size; i++)
-      if (byte_counter[i] > 0)
-        count2mult[byte_counter[i]]++;
+    for (size_t i = 0; i < logical_page_size; i++) {
+      bytecount_t count = pte->count_at(i);
+      if (count > 0)
+        count2mult[count]++;
+    }
   }
 
   // Convert count2mult from a map to a vector.
@@ -132,6 +296,8 @@ static void get_address_tally_hist (WordPageTable& mapping, vector<bf_addr_tally
 // we build the latter.
 void bf_get_address_tally_hist (vector<bf_addr_tally_t>& histogram, uint64_t* total)
 {
+  finish_thread_tables();
+  lock_guard<mutex> guard(thread_tables_mutex);
   get_address_tally_hist(*global_unique_bytes, histogram, total);
 }
 
@@ -37,6 +37,22 @@ namespace bytesflops_pass {
   FindMemFootprint("bf-mem-footprint", cl::init(false), cl::NotHidden,
                    cl::desc("Tabulate the minimum amount of memory needed for various cache hit rates"));
 
+  // Define a command-line option for estimating per-function unique bytes
+  // with a fixed-size HyperLogLog sketch instead of an exact page table.
+  cl::opt<unsigned long long>
+  UniqueSketchBits("bf-unique-sketch", cl::init(0), cl::NotHidden,
+                   cl::desc("Estimate per-function unique bytes with a sketch of 2^bits registers (0=exact)"),
+                   cl::value_desc("bits"));
+
+  // Define a command-line option for the granularity at which those
+  // sketches count unique bytes.  Each access is collapsed to the distinct
+  // granules it touches (e.g., 64 for cache lines), which saves hashing
+  // every byte.
+  cl::opt<unsigned long long>
+  UniqueSketchGranularity("bf-unique-sketch-granularity", cl::init(1), cl::NotHidden,
+                          cl::desc("Count per-function unique bytes in sketches over aligned blocks of this many bytes"),
+                          cl::value_desc("bytes"));
+
   // Define a command-line option for tallying loads and stored by
   // data structure.
   cl::opt<bool>
@@ -108,6 +124,30 @@ namespace bytesflops_pass {
                cl::desc("Treat addresses not touched after this many accesses as untouched"),
                cl::value_desc("accesses"));
 
+  // Define a command-line option for the granularity at which reuse distance
+  // is computed.  Each access is collapsed to the distinct granules it
+  // touches (e.g., 8 for words, 64 for cache lines, 4096 for pages).
+  cl::opt<unsigned long long>
+  ReuseGranularity("bf-reuse-granularity", cl::init(1), cl::NotHidden,
+                   cl::desc("Compute reuse distance over aligned blocks of this many bytes"),
+                   cl::value_desc("bytes"));
+
+  // Define a command-line option for approximating reuse distance.  A
+  // nonzero value replaces the exact reuse-distance tree with one that merges
+  // timestamps while keeping each distance within the given relative error.
+  cl::opt<double>
+  ReuseError("bf-reuse-error", cl::init(0.0), cl::NotHidden,
+             cl::desc("Approximate reuse distance to within this relative error (0=exact)"),
+             cl::value_desc("fraction"));
+
+  // Define a command-line option for the precision of the reuse-distance
+  // histogram.  Distances below 2^(bits+1) are binned exactly; each larger
+  // power of two is split into 2^bits bins.
+  cl::opt<unsigned long long>
+  ReuseBinBits("bf-reuse-bin-bits", cl::init(7), cl::NotHidden,
+               cl::desc("Log base 2 of the number of reuse-distance histogram bins per power of two"),
+               cl::value_desc("bits"));
+
   // Define a command-line option for turning on the cache model.
   // Doing so will create private-cache.dump,
   // remote-shared-cache.dump, and shared-cache.dump files on each
@@ -129,6 +169,14 @@ namespace bytesflops_pass {
                cl::desc("Log base 2 of the maximum number of sets modeled at the same time."),
                cl::value_desc("bits"));
 
+  // Define a command-line option to spatially sample the addresses fed to
+  // the reuse-distance calculator and the cache lines fed to the cache
+  // model.
+  cl::opt<unsigned long long>
+  SamplePeriod("bf-sample-period", cl::init(1), cl::NotHidden,
+               cl::desc("Model reuse distance and caches using a hash-selected one in this many addresses and cache lines."),
+               cl::value_desc("count"));
+
   static RegisterPass<BytesFlops> H("bytesflops", "Bytes:flops instrumentation");
 
   // Define a command-line option for tracking load/store strides.
@@ -66,6 +66,12 @@ namespace bytesflops_pass {
   // working-set size.
   extern cl::opt<bool> FindMemFootprint;
 
+  // Define a command-line option for estimating per-function unique bytes.
+  extern cl::opt<unsigned long long> UniqueSketchBits;
+
+  // Define a command-line option for the granularity of those sketches.
+  extern cl::opt<unsigned long long> UniqueSketchGranularity;
+
   // Define a command-line option for tallying loads and stored by
   // data structure.
   extern cl::opt<bool> TallyByDataStruct;
@@ -109,6 +115,15 @@ namespace bytesflops_pass {
   // Define a command-line option for pruning reuse distance.
   extern cl::opt<unsigned long long> MaxReuseDist;
 
+  // Define a command-line option for the reuse-distance granularity.
+  extern cl::opt<unsigned long long> ReuseGranularity;
+
+  // Define a command-line option for approximating reuse distance.
+  extern cl::opt<double> ReuseError;
+
+  // Define a command-line option for the reuse-distance histogram precision.
+  extern cl::opt<unsigned long long> ReuseBinBits;
+
   // Define a command-line option for turning on the cache model.
   extern cl::opt<bool> CacheModel;
 
@@ -118,6 +133,9 @@ namespace bytesflops_pass {
   // Define a command-line option for log2 of the maximum number of sets to model.
   extern cl::opt<unsigned long long> CacheMaxSetBits;
 
+  // Define a command-line option for spatially sampling addresses and lines.
+  extern cl::opt<unsigned long long> SamplePeriod;
+
   // Define a command-line option for tracking load/store strides.
   extern cl::opt<bool> TrackStrides;
 
@@ -239,6 +257,7 @@ namespace bytesflops_pass {
     Function* assoc_addrs_with_dstruct_stack;  // Pointer to bf_assoc_addresses_with_dstruct_stack
     Function* disassoc_addrs_with_dstruct;  // Pointer to bf_disassoc_addresses_with_dstruct
     Function* reuse_dist_prog;   // Pointer to bf_reuse_dist_addrs_prog()
+    Function* reuse_dist_func;   // Pointer to bf_reuse_dist_addrs_func()
     Function* memset_intrinsic;  // Pointer to LLVM's memset() intrinsic
     Function* access_cache;      // Pointer to bf_touch_cache()
     Function* tally_bb_exec;     // Pointer to bf_tally_bb_execution()
@@ -419,8 +438,20 @@ namespace bytesflops_pass {
                                BasicBlock::iterator& terminator_inst,
                                int& must_clear);
 
+    // Report a range of memory addresses to the address-based analyses.
+    void instrument_address_range(Module* module,
+                                  StringRef function_name,
+                                  Value* mem_addr,
+                                  Value* num_bytes,
+                                  bool is_store,
+                                  Instruction* insert_before);
+
+    // Convert a memory intrinsic's length to a 64-bit integer.
+    Value* range_length(Value* length, BasicBlock::iterator& insert_before);
+
     // Instrument Call instructions.
     void instrument_call(Module* module,
+                         StringRef function_name,
                          BasicBlock::iterator& iter,
                          BasicBlock::iterator& insert_before,
                          int& must_clear);
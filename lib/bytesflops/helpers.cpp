@@ -131,6 +131,18 @@ void BytesFlops::mark_as_byfl(Instruction* inst)
   inst->setMetadata("byfl", meta);
 }
 
+// Insert before a given instruction some code to convert a memory
+// intrinsic's length to a 64-bit integer, and return the result.
+Value* BytesFlops::range_length(Value* length, BasicBlock::iterator& insert_before)
+{
+  if (length->getType()->getIntegerBitWidth() >= 64)
+    return length;
+  ZExtInst* length64 = new ZExtInst(length, IntegerType::get(length->getContext(), 64),
+                                    "nbytes", &*insert_before);
+  mark_as_byfl(length64);
+  return length64;
+}
+
 // Insert after a given instruction some code to increment a global
 // variable.
 void BytesFlops::increment_global_variable(BasicBlock::iterator& insert_before,
@@ -272,6 +272,16 @@ namespace bytesflops_pass {
     // Assign a value to bf_unique_bytes.
     create_global_constant(module, "bf_unique_bytes", bool(TrackUniqueBytes) || bool(FindMemFootprint));
 
+    // Assign a value to bf_unique_sketch_bits.
+    if (UniqueSketchBits != 0 && (UniqueSketchBits < 4 || UniqueSketchBits > 18))
+      report_fatal_error("-bf-unique-sketch must be 0 or from 4 to 18");
+    create_global_constant(module, "bf_unique_sketch_bits", uint64_t(UniqueSketchBits));
+
+    // Assign a value to bf_unique_sketch_granularity.
+    if (UniqueSketchGranularity == 0 || (UniqueSketchGranularity & (UniqueSketchGranularity - 1)) != 0)
+      report_fatal_error("-bf-unique-sketch-granularity must be a power of two");
+    create_global_constant(module, "bf_unique_sketch_granularity", uint64_t(UniqueSketchGranularity));
+
     // Assign a value to bf_vectors.
     create_global_constant(module, "bf_vectors", bool(TallyVectors));
 
@@ -284,6 +294,21 @@ namespace bytesflops_pass {
     // Assign a value to bf_max_reuse_dist.
     create_global_constant(module, "bf_max_reuse_distance", uint64_t(MaxReuseDist));
 
+    // Assign a value to bf_reuse_granularity.
+    if (ReuseGranularity == 0 || (ReuseGranularity & (ReuseGranularity - 1)) != 0)
+      report_fatal_error("-bf-reuse-granularity must be a power of two");
+    create_global_constant(module, "bf_reuse_granularity", uint64_t(ReuseGranularity));
+
+    // Assign a value to bf_reuse_error_ppm.
+    if (ReuseError < 0.0 || ReuseError >= 1.0)
+      report_fatal_error("-bf-reuse-error must be at least 0 and less than 1");
+    create_global_constant(module, "bf_reuse_error_ppm", uint64_t(ReuseError*1.0e6 + 0.5));
+
+    // Assign a value to bf_reuse_bin_bits.
+    if (ReuseBinBits > 20)
+      report_fatal_error("-bf-reuse-bin-bits must be no greater than 20");
+    create_global_constant(module, "bf_reuse_bin_bits", uint64_t(ReuseBinBits));
+
     // Assign a value to bf_cache_model.
     create_global_constant(module, "bf_cache_model", bool(CacheModel));
 
@@ -293,6 +318,11 @@ namespace bytesflops_pass {
     // Assign a value to bf_max_sets.
     create_global_constant(module, "bf_max_set_bits", uint64_t(CacheMaxSetBits));
 
+    // Assign a value to bf_sample_period.
+    if (SamplePeriod == 0)
+      report_fatal_error("-bf-sample-period must be positive");
+    create_global_constant(module, "bf_sample_period", uint64_t(SamplePeriod));
+
     // Create a global string that stores all of our command-line options.
     vector<string> command_line = parse_command_line();   // All command-line arguments
     string bf_cmdline;   // Reconstructed command line with -bf-* options only
@@ -538,11 +568,12 @@ namespace bytesflops_pass {
       vector<Type*> all_function_args;
       all_function_args.push_back(uint64_arg);
       all_function_args.push_back(uint64_arg);
+      all_function_args.push_back(uint8_arg);
       FunctionType* void_func_result =
         FunctionType::get(Type::getVoidTy(globctx), all_function_args, false);
       access_cache =
         declare_extern_c(void_func_result,
-                         "_ZN10bytesflops14bf_touch_cacheEmm",
+                         "_ZN10bytesflops14bf_touch_cacheEmmh",
                          &module);
     }
 
@@ -594,6 +625,20 @@ namespace bytesflops_pass {
         declare_extern_c(void_func_result,
                          "bf_reuse_dist_addrs_prog",
                          &module);
+
+      // When tallying by function, inject an external declaration for
+      // bf_reuse_dist_addrs_func(), which additionally attributes reuse
+      // distances to a function.
+      if (TallyByFunction) {
+        all_function_args.insert(all_function_args.begin(),
+                                 IntegerType::get(globctx, 8*sizeof(FunctionKeyGen::KeyID)));
+        FunctionType* void_key_func_result =
+          FunctionType::get(Type::getVoidTy(globctx), all_function_args, false);
+        reuse_dist_func =
+          declare_extern_c(void_key_func_result,
+                           "bf_reuse_dist_addrs_func",
+                           &module);
+      }
     }
 
     // Inject external declarations for bf_acquire_mega_lock() and
@@ -144,6 +144,65 @@ namespace bytesflops_pass {
     increment_global_array(iter, mem_insts_var, idxVal, one);
   }
 
+  // Report a range of memory addresses accessed by a load, store, or memory
+  // intrinsic to the unique-byte, footprint, cache-model, and reuse-distance
+  // analyses.  The run-time library marks each range in bulk.
+  void BytesFlops::instrument_address_range(Module* module,
+                                            StringRef function_name,
+                                            Value* mem_addr,
+                                            Value* num_bytes,
+                                            bool is_store,
+                                            Instruction* insert_before) {
+    LLVMContext& globctx = module->getContext();
+
+    // If requested by the user, insert a call to
+    // bf_assoc_addresses_with_prog() and perhaps
+    // bf_assoc_addresses_with_func().
+    if (TrackUniqueBytes || FindMemFootprint) {
+      // Conditionally insert a call to bf_assoc_addresses_with_func().
+      if (TallyByFunction) {
+        vector<Value*> arg_list;
+        arg_list.push_back(map_func_name_to_arg(module, function_name));
+        arg_list.push_back(mem_addr);
+        arg_list.push_back(num_bytes);
+        callinst_create(assoc_addrs_with_func, arg_list, insert_before);
+      }
+
+      // Unconditionally insert a call to bf_assoc_addresses_with_prog().
+      vector<Value*> arg_list;
+      arg_list.push_back(mem_addr);
+      arg_list.push_back(num_bytes);
+      callinst_create(assoc_addrs_with_prog, arg_list, insert_before);
+    }
+
+    // If requested by the user, insert a call to bf_touch_cache().
+    if (CacheModel) {
+      uint8_t load0store1 = is_store ? 1 : 0;
+      vector<Value*> arg_list;
+      arg_list.push_back(mem_addr);
+      arg_list.push_back(num_bytes);
+      arg_list.push_back(ConstantInt::get(globctx, APInt(8, load0store1)));
+      callinst_create(access_cache, arg_list, insert_before);
+    }
+
+    // If requested by the user, also insert a call to
+    // bf_reuse_dist_addrs_prog() or, when tallying by function,
+    // bf_reuse_dist_addrs_func().
+    if ((!is_store && (rd_bits&(1<<RD_LOADS)) != 0)
+        || (is_store && (rd_bits&(1<<RD_STORES)) != 0)) {
+      vector<Value*> arg_list;
+      if (TallyByFunction) {
+        FunctionKeyGen::KeyID keyval = record_func(function_name.str());
+        arg_list.push_back(ConstantInt::get(IntegerType::get(globctx, 8*sizeof(FunctionKeyGen::KeyID)),
+                                            keyval));
+      }
+      arg_list.push_back(mem_addr);
+      arg_list.push_back(num_bytes);
+      callinst_create(TallyByFunction ? reuse_dist_func : reuse_dist_prog,
+                      arg_list, insert_before);
+    }
+  }
+
   // Instrument Load and Store instructions.
   void BytesFlops::instrument_load_store(Module* module,
                                          StringRef function_name,
@@ -198,43 +257,10 @@ namespace bytesflops_pass {
       mark_as_byfl(mem_addr);
     }
 
-    // If requested by the user, also insert a call to
-    // bf_assoc_addresses_with_prog() and perhaps
-    // bf_assoc_addresses_with_func().
-    if (TrackUniqueBytes || FindMemFootprint) {
-      // Conditionally insert a call to bf_assoc_addresses_with_func().
-      if (TallyByFunction) {
-        vector<Value*> arg_list;
-        arg_list.push_back(map_func_name_to_arg(module, function_name));
-        arg_list.push_back(mem_addr);
-        arg_list.push_back(num_bytes);
-        callinst_create(assoc_addrs_with_func, arg_list, &*insert_before);
-      }
-
-      // Unconditionally insert a call to bf_assoc_addresses_with_prog().
-      vector<Value*> arg_list;
-      arg_list.push_back(mem_addr);
-      arg_list.push_back(num_bytes);
-      callinst_create(assoc_addrs_with_prog, arg_list, &*insert_before);
-    }
-
-    // If requested by the user, insert a call to bf_touch_cache().
-    if (CacheModel) {
-      vector<Value*> arg_list;
-      arg_list.push_back(mem_addr);
-      arg_list.push_back(num_bytes);
-      callinst_create(access_cache, arg_list, &*insert_before);
-    }
-
-    // If requested by the user, also insert a call to
-    // bf_reuse_dist_addrs_prog().
-    if ((opcode == Instruction::Load && (rd_bits&(1<<RD_LOADS)) != 0)
-        || (opcode == Instruction::Store && (rd_bits&(1<<RD_STORES)) != 0)) {
-      vector<Value*> arg_list;
-      arg_list.push_back(mem_addr);
-      arg_list.push_back(num_bytes);
-      callinst_create(reuse_dist_prog, arg_list, &*insert_before);
-    }
+    // Report the range of addresses to the address-based analyses.
+    if (mem_addr != nullptr)
+      instrument_address_range(module, function_name, mem_addr, num_bytes,
+                               opcode == Instruction::Store, &*insert_before);
 
     // If requested by the user, also insert a call to bf_track_stride().
     if (TrackStrides) {
@@ -313,6 +339,7 @@ namespace bytesflops_pass {
   // Instrument Call instructions.  Note that we've already skipped
   // over calls to llvm.dbg.*.
   void BytesFlops::instrument_call(Module* module,
+                                   StringRef function_name,
                                    BasicBlock::iterator& iter,
                                    BasicBlock::iterator& insert_before,
                                    int& must_clear) {
@@ -324,7 +351,10 @@ namespace bytesflops_pass {
     Function* func = call_inst->getCalledFunction();
     StringRef callee_name = func ? func->getName() : "*UNNAMED*";
 
-    // Tally calls to the LLVM memory intrinsics (llvm.mem{set,cpy,move}.*).
+    // Tally calls to the LLVM memory intrinsics (llvm.mem{set,cpy,move}.*)
+    // and, if any address-based analysis is enabled, report the ranges of
+    // addresses they access.
+    bool track_ranges = TrackUniqueBytes || FindMemFootprint || rd_bits > 0 || CacheModel;
     if (isa<MemIntrinsic>(inst)) {
       if (MemSetInst* memsetfunc = dyn_cast<MemSetInst>(inst)) {
         // Handle llvm.memset.* by incrementing the memset tally and
@@ -333,6 +363,17 @@ namespace bytesflops_pass {
         increment_global_array(insert_before, mem_intrinsics_var, callVal, one);
         ConstantInt* byteVal = ConstantInt::get(globctx, APInt(64, BF_MEMSET_BYTES));
         increment_global_array(insert_before, mem_intrinsics_var, byteVal, memsetfunc->getLength());
+        if (track_ranges) {
+          // Report the bytes set as a store.
+          Value* num_bytes = range_length(memsetfunc->getLength(), insert_before);
+          CastInst* mem_addr =
+            new PtrToIntInst(memsetfunc->getDest(),
+                             IntegerType::get(globctx, 64),
+                             "", &*insert_before);
+          mark_as_byfl(mem_addr);
+          instrument_address_range(module, function_name, mem_addr, num_bytes,
+                                   true, &*insert_before);
+        }
         if (TallyByDataStruct) {
           // We can't delay instrumentation to the end of the basic block.  We
           // have to do it now in case the data are about to be deallocated.
@@ -375,6 +416,25 @@ namespace bytesflops_pass {
         increment_global_array(insert_before, mem_intrinsics_var, callVal, one);
         ConstantInt* byteVal = ConstantInt::get(globctx, APInt(64, BF_MEMXFER_BYTES));
         increment_global_array(insert_before, mem_intrinsics_var, byteVal, memxferfunc->getLength());
+        if (track_ranges) {
+          // Report the source bytes as a load and the destination bytes as
+          // a store.
+          Value* num_bytes = range_length(memxferfunc->getLength(), insert_before);
+          CastInst* mem_addr =
+            new PtrToIntInst(memxferfunc->getSource(),
+                             IntegerType::get(globctx, 64),
+                             "", &*insert_before);
+          mark_as_byfl(mem_addr);
+          instrument_address_range(module, function_name, mem_addr, num_bytes,
+                                   false, &*insert_before);
+          mem_addr =
+            new PtrToIntInst(memxferfunc->getDest(),
+                             IntegerType::get(globctx, 64),
+                             "", &*insert_before);
+          mark_as_byfl(mem_addr);
+          instrument_address_range(module, function_name, mem_addr, num_bytes,
+                                   true, &*insert_before);
+        }
         if (TallyByDataStruct) {
           // We can't delay instrumentation to the end of the basic block.  We
           // have to do it now in case the data are about to be deallocated.
@@ -929,7 +989,7 @@ namespace bytesflops_pass {
             break;
 
           case Instruction::Call:
-            instrument_call(module, iter, terminator_inst, must_clear);
+            instrument_call(module, function_name, iter, terminator_inst, must_clear);
             break;
 
           case Instruction::Alloca:
@@ -0,0 +1,35 @@
+#! /bin/sh
+
+#######################################
+# Ensure that memset, memcpy, and     #
+# memmove report the bytes they touch #
+# to the unique-byte tracker          #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Define some helper variables.  The ":-" ones will normally be
+# provided by the Makefile.
+AWK=${AWK:-awk}
+PERL=${PERL:-perl}
+srcdir=${srcdir:-../../tests}
+top_srcdir=${top_srcdir:-../..}
+top_builddir=${top_builddir:-..}
+bf_clang="$top_builddir/tools/wrappers/bf-clang"
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Instrument a program that touches two 1 MB buffers only through memory
+# intrinsics.
+"$PERL" -I"$top_srcdir/tools/wrappers" \
+  "$bf_clang" -bf-plugin="$top_builddir/lib/bytesflops/.libs/bytesflops.so" \
+              -bf-verbose -O2 -g -o memintrinsics "$srcdir/memintrinsics.c" \
+              -L"$top_builddir/lib/byfl/.libs" \
+              -bf-unique-bytes
+
+# The program must report at least the 2 MB the intrinsics touched as unique.
+output=`env LD_LIBRARY_PATH="$top_builddir/lib/byfl/.libs:$LD_LIBRARY_PATH" BF_BINOUT= ./memintrinsics`
+unique_bytes=`echo "$output" | "$AWK" '/ unique bytes$/ {print $2}'`
+test "$unique_bytes" -ge 2097152
@@ -0,0 +1,77 @@
+/*
+ * Definitions shared by the tests that drive the Byfl run-time
+ * library directly instead of through an instrumented program
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#ifndef _BFTEST_H_
+#define _BFTEST_H_
+
+#include "byfl.h"
+
+using namespace std;
+using namespace bytesflops;
+
+// The following constants would normally be defined by the instrumented
+// code.  Each has the default value the bytesflops pass would give it; a
+// test adjusts those it needs before calling bf_test_initialize().
+uint64_t bf_bb_merge = 1;
+uint8_t  bf_call_stack = 0;
+uint8_t  bf_every_bb = 0;
+uint64_t bf_max_reuse_distance = ~uint64_t(0) - 1;
+uint64_t bf_reuse_granularity = 1;
+uint64_t bf_reuse_error_ppm = 0;
+uint64_t bf_reuse_bin_bits = 7;
+const char* bf_option_string = "";
+uint8_t  bf_per_func = 0;
+uint8_t  bf_mem_footprint = 0;
+uint8_t  bf_tally_inst_mix = 0;
+uint8_t  bf_tally_inst_deps = 0;
+uint8_t  bf_types = 0;
+uint8_t  bf_unique_bytes = 0;
+uint64_t bf_unique_sketch_bits = 0;
+uint64_t bf_unique_sketch_granularity = 1;
+uint8_t  bf_vectors = 0;
+uint8_t  bf_cache_model = 0;
+uint8_t  bf_data_structs = 0;
+uint8_t  bf_strides = 0;
+uint64_t bf_line_size = 64;
+uint64_t bf_max_set_bits = 16;
+uint64_t bf_sample_period = 1;
+
+// The following run-time functions are called by instrumented code but are
+// not otherwise declared.
+extern "C" {
+  extern void bf_initialize_if_necessary(void);
+  extern void bf_assoc_addresses_with_prog(uint64_t baseaddr, uint64_t numaddrs);
+  extern void bf_assoc_addresses_with_func(const char* funcname, uint64_t baseaddr, uint64_t numaddrs);
+  extern void bf_assoc_addresses_with_prog_tb(uint64_t baseaddr, uint64_t numaddrs);
+  extern void bf_assoc_addresses_with_func_tb(const char* funcname, uint64_t baseaddr, uint64_t numaddrs);
+  extern void bf_reuse_dist_addrs_prog(uint64_t baseaddr, uint64_t numaddrs);
+  extern void bf_reuse_dist_addrs_func(KeyType_t funcID, uint64_t baseaddr, uint64_t numaddrs);
+}
+namespace bytesflops {
+  extern void bf_touch_cache(uint64_t baseaddr, uint64_t numaddrs, uint8_t load0store1);
+}
+
+// Initialize the run-time library as an instrumented program's first call
+// would.  Unless the caller says otherwise, discard the binary output so
+// that tests leave no files behind.
+static void bf_test_initialize (void)
+{
+  setenv("BF_BINOUT", "", 0);
+  bf_initialize_if_necessary();
+}
+
+// Fail the test with a message if a condition does not hold.  Failing
+// this way skips the end-of-program report.
+#define BF_CHECK(COND)                                                  \
+  do {                                                                  \
+    if (!(COND)) {                                                      \
+      cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #COND "\n"; \
+      bf_abend();                                                       \
+    }                                                                   \
+  } while (0)
+
+#endif
@@ -0,0 +1,18 @@
+#! /bin/sh
+
+#######################################
+# Ensure that both LRU stack-distance #
+# engines in the cache model agree    #
+# with a reference model              #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Run the same trace through each engine.
+for engine in linear tree ; do
+  env BF_CACHE_ENGINE=$engine ./cache-lru
+done
@@ -0,0 +1,36 @@
+/*
+ * Sweep arrays of known sizes through a two-level cache hierarchy so that
+ * each level sees a known number of misses and write-backs
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include "bftest.h"
+
+// Access every line of an array a given number of times.
+static void sweep (uint64_t base, uint64_t num_lines, int repetitions, uint8_t load0store1=0)
+{
+  for (int r = 0; r < repetitions; r++)
+    for (uint64_t line = 0; line < num_lines; line++)
+      bf_touch_cache(base + line*64, 8, load0store1);
+}
+
+int main (void)
+{
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 1;
+  bf_test_initialize();
+
+  // With a 4 KB L1 cache and a 64 KB L2 cache, a 2 KB array misses in
+  // both levels only on first touch, while a 32 KB array misses in L1 on
+  // every access but in L2 only on first touch.
+  sweep(0x1000000, 32, 10);
+  sweep(0x2000000, 512, 3);
+
+  // Lines stored to are written back to memory once a 128 KB array has
+  // flushed them from both levels.
+  sweep(0x3000000, 128, 1, 1);
+  sweep(0x4000000, 2048, 1);
+  return 0;
+}
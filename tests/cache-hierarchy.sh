@@ -0,0 +1,19 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the cache-hierarchy     #
+# model reports known miss and        #
+# write-back counts                   #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Sweep arrays through a 4 KB, 4-way L1 cache and a 64 KB, 8-way L2 cache.
+output=`env BF_CACHE_HIERARCHY=4K:4,64K:8 ./cache-hierarchy`
+echo "$output" | grep -q ' 3744 L1 misses ( 92.9% of 4032 accesses)'
+echo "$output" | grep -q ' 2720 L2 misses ( 72.6% of 3744 accesses)'
+echo "$output" | grep -q ' 128 dirty lines written back to memory'
@@ -0,0 +1,92 @@
+/*
+ * Check the cache model's LRU stack distances against a simple
+ * reference model, using whichever engine BF_CACHE_ENGINE selects
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <list>
+#include <random>
+#include "bftest.h"
+
+// Model one access to a line in a set of LRU stacks, one per set, and
+// return the line's stack distance, or 0 on a cold miss.
+static uint64_t reference_access (vector<list<uint64_t> >& stacks,
+                                  uint64_t set_bits, uint64_t line)
+{
+  list<uint64_t>& stack = stacks[line & ((uint64_t(1) << set_bits) - 1)];
+  uint64_t distance = 1;
+  for (auto iter = stack.begin(); iter != stack.end(); iter++, distance++)
+    if (*iter == line) {
+      stack.erase(iter);
+      stack.push_front(line);
+      return distance;
+    }
+  stack.push_front(line);
+  return 0;
+}
+
+int main (void)
+{
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 6;
+  bf_test_initialize();
+
+  // Replay a trace that mixes a small hot set, strided sweeps, and
+  // misaligned accesses that straddle two lines.
+  vector<vector<list<uint64_t> > > stacks(bf_max_set_bits);
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    stacks[set].resize(uint64_t(1) << set);
+  vector<LogHistogram> ref_hits(bf_max_set_bits);
+  uint64_t ref_cold_misses = 0;
+  uint64_t ref_accesses = 0;
+  mt19937_64 rng(1);
+  const uint64_t base = 0x100000;
+  for (int i = 0; i < 20000; i++) {
+    uint64_t addr, nbytes;
+    switch (rng() % 4) {
+      case 0:
+        addr = base + (rng() % 16)*64;
+        nbytes = 8;
+        break;
+      case 1:
+        addr = base + (uint64_t(i)*3 % 2048)*64;
+        nbytes = 4;
+        break;
+      case 2:
+        addr = base + (rng() % 1024)*64 + 60;
+        nbytes = 8;
+        break;
+      default:
+        addr = base + rng() % (2048*64);
+        nbytes = 1 + rng() % 16;
+        break;
+    }
+    bf_touch_cache(addr, nbytes, uint8_t(rng() % 2));
+    for (uint64_t line = addr/64; line <= (addr + nbytes - 1)/64; line++) {
+      ref_accesses++;
+      for (uint64_t set = 0; set < bf_max_set_bits; set++) {
+        uint64_t distance = reference_access(stacks[set], set, line);
+        if (distance > 0)
+          ref_hits[set].increment(distance);
+        else if (set == 0)
+          ref_cold_misses++;
+      }
+    }
+  }
+
+  // The private and shared caches both saw every access.
+  vector<LogHistogram> private_hits(bf_get_private_cache_hits());
+  const vector<LogHistogram>& shared_hits = bf_get_shared_cache_hits();
+  BF_CHECK(bf_get_private_cache_accesses() == ref_accesses);
+  BF_CHECK(bf_get_shared_cache_accesses() == ref_accesses);
+  BF_CHECK(bf_get_private_cold_misses() == ref_cold_misses);
+  BF_CHECK(bf_get_shared_cold_misses() == ref_cold_misses);
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (size_t bin = 0; bin < LogHistogram::num_bins; bin++) {
+      BF_CHECK(private_hits[set][bin] == ref_hits[set][bin]);
+      BF_CHECK(shared_hits[set][bin] == ref_hits[set][bin]);
+    }
+  return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Check the cache model's prefetch fills and useful prefetches against a
+ * simple reference model of prefetching caches
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cstring>
+#include <list>
+#include <random>
+#include "bftest.h"
+
+// Model an LRU cache into which lines can be prefetched.  A prefetch that
+// misses fills the line, and the prefetch is useful if the line is
+// demanded before being evicted.
+class ReferenceCache {
+public:
+  ReferenceCache(uint64_t set_bits, uint64_t ways) :
+    sets(uint64_t(1) << set_bits), ways(ways), fills(0), useful(0) { }
+
+  // Access a line by demand or by prefetch.
+  void access (uint64_t line, bool is_prefetch) {
+    list<pair<uint64_t, bool> >& stack = sets[line % sets.size()];
+    bool prefetched = false;
+    bool found = false;
+    for (auto iter = stack.begin(); iter != stack.end(); iter++)
+      if (iter->first == line) {
+        prefetched = iter->second;
+        found = true;
+        stack.erase(iter);
+        break;
+      }
+    if (is_prefetch) {
+      fills += !found;
+      prefetched = prefetched || !found;
+    }
+    else {
+      useful += prefetched;
+      prefetched = false;
+    }
+    stack.push_front(make_pair(line, prefetched));
+    if (stack.size() > ways)
+      stack.pop_back();
+  }
+
+  vector<list<pair<uint64_t, bool> > > sets;  // MRU first; true if prefetched but not demanded
+  uint64_t ways;         // Maximum lines per set
+  uint64_t fills;        // Lines filled by prefetches
+  uint64_t useful;       // Prefetched lines demanded before eviction
+};
+
+// Apply an access or prefetch to every reference cache.
+static void reference_access (vector<ReferenceCache>& ref, uint64_t line,
+                              bool is_prefetch)
+{
+  for (auto& cache: ref)
+    cache.access(line, is_prefetch);
+}
+
+int main (void)
+{
+  const char* prefetchers = getenv("BF_CACHE_PREFETCH");
+  if (prefetchers == nullptr)
+    prefetchers = "";
+  bool next_line = strstr(prefetchers, "next-line") != nullptr;
+  bool strides = strstr(prefetchers, "stride") != nullptr;
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 4;
+  bf_strides = 1;
+  bf_test_initialize();
+
+  // Replay a trace of short sequential runs and strided prefetches
+  // through the cache model and through reference caches of every
+  // power-of-two associativity the model reports.  Track the most
+  // recently used line as the model does, as prefetching it is a no-op.
+  vector<ReferenceCache> ref;
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2)
+      ref.push_back(ReferenceCache(set, ways));
+  mt19937_64 rng(1);
+  const uint64_t base = 0x100000;
+  uint64_t prev_line = ~uint64_t(0);
+  uint64_t mru_line = ~uint64_t(0);
+  uint64_t prefetches = 0;
+  for (int run = 0; run < 2000; run++) {
+    uint64_t addr = base + (rng() % 2048)*64 + rng() % 64;
+    int64_t stride = int64_t(rng() % 512) - 256;
+    int run_length = 1 + rng() % 8;
+    for (int i = 0; i < run_length; i++, addr += 24) {
+      bf_touch_cache(addr, 16, uint8_t(rng() % 2));
+      for (uint64_t line = addr/64; line <= (addr + 15)/64; line++)
+        reference_access(ref, line, false);
+      mru_line = (addr + 15)/64;
+      if (next_line && mru_line != prev_line) {
+        prev_line = mru_line;
+        reference_access(ref, mru_line + 1, true);
+        mru_line++;
+        prefetches++;
+      }
+      bf_prefetch_stride(addr, stride);
+      uint64_t target = (addr + uint64_t(stride))/64;
+      if (strides && target != addr/64 && target != mru_line) {
+        reference_access(ref, target, true);
+        mru_line = target;
+        prefetches++;
+      }
+    }
+  }
+
+  // The private and shared caches both saw the same prefetches as the
+  // reference caches.
+  BF_CHECK(bf_get_private_prefetches() == prefetches);
+  size_t idx = 0;
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2, idx++) {
+      uint64_t fills, useful;
+      bf_get_private_prefetch_traffic(set, ways, &fills, &useful);
+      BF_CHECK(fills == ref[idx].fills);
+      BF_CHECK(useful == ref[idx].useful);
+      bf_get_shared_prefetch_traffic(set, ways, &fills, &useful);
+      BF_CHECK(fills == ref[idx].fills);
+      BF_CHECK(useful == ref[idx].useful);
+    }
+  return 0;
+}
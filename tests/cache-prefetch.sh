@@ -0,0 +1,24 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the cache model counts  #
+# prefetch fills and useful           #
+# prefetches correctly                #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Try each prefetcher alone and both together.
+for prefetchers in next-line stride next-line,stride ; do
+  env BF_CACHE_PREFETCH=$prefetchers ./cache-prefetch
+done
+
+# Reject unknown prefetchers.
+if env BF_CACHE_PREFETCH=next-page ./cache-prefetch 2> cache-prefetch.err ; then
+  exit 1
+fi
+grep -q 'BF_CACHE_PREFETCH must be a comma-separated list' cache-prefetch.err
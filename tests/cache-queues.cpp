@@ -0,0 +1,76 @@
+/*
+ * Ensure that queueing accesses to the shared cache model loses none of
+ * them, even once the queues have been finished
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <dirent.h>
+#include <thread>
+#include "bftest.h"
+
+// Access a range of lines repeatedly.
+static void sweep (uint64_t base, uint64_t num_lines, int repetitions)
+{
+  for (int r = 0; r < repetitions; r++)
+    for (uint64_t line = 0; line < num_lines; line++)
+      bf_touch_cache(base + line*64, 8, uint8_t(line % 2));
+}
+
+// Return the number of threads in this process, or 0 if that can't be
+// determined.
+static size_t count_threads (void)
+{
+  DIR* tasks = opendir("/proc/self/task");
+  if (tasks == nullptr)
+    return 0;
+  size_t num_threads = 0;
+  while (struct dirent* entry = readdir(tasks))
+    if (entry->d_name[0] != '.')
+      num_threads++;
+  closedir(tasks);
+  return num_threads;
+}
+
+// Ensure that the shared cache saw exactly what the private caches saw.
+static void check_totals (void)
+{
+  BF_CHECK(bf_get_shared_cache_accesses() == bf_get_private_cache_accesses());
+  BF_CHECK(bf_get_shared_cold_misses() == bf_get_private_cold_misses());
+}
+
+int main (void)
+{
+  setenv("BF_CACHE_QUEUE", "1", 1);
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 4;
+  bf_test_initialize();
+
+  // A single thread's queued accesses reach the shared cache in order, so
+  // its hits match the thread's private hits.
+  sweep(0x100000, 1000, 5);
+  vector<LogHistogram> private_hits(bf_get_private_cache_hits());
+  const vector<LogHistogram>& shared_hits = bf_get_shared_cache_hits();
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (size_t bin = 0; bin < LogHistogram::num_bins; bin++)
+      BF_CHECK(private_hits[set][bin] == shared_hits[set][bin]);
+  check_totals();
+
+  // Accesses made after the queues were finished are still modeled.
+  sweep(0x100000, 1000, 1);
+  check_totals();
+
+  // So are those of threads that first access the cache after the queues
+  // were finished, and no consumer thread is left running.
+  thread late_threads[2] = {
+    thread(sweep, 0x200000, 500, 3),
+    thread(sweep, 0x300000, 700, 2)
+  };
+  for (auto& late_thread: late_threads)
+    late_thread.join();
+  check_totals();
+  size_t num_threads = count_threads();
+  BF_CHECK(num_threads == 0 || num_threads == 1);
+  return 0;
+}
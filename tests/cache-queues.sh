@@ -0,0 +1,17 @@
+#! /bin/sh
+
+#######################################
+# Ensure that queueing accesses to    #
+# the shared cache model loses none   #
+# of them                             #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Queue accesses from several threads, some of which start only after the
+# queues have been finished.
+./cache-queues
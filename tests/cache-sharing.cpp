@@ -0,0 +1,41 @@
+/*
+ * Store to cache lines from a succession of threads so that the sharing
+ * detector sees a known number of false- and true-sharing transfers
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <thread>
+#include "bftest.h"
+
+// Store to a range of bytes from a new thread.
+static void store_from_thread (uint64_t baseaddr, uint64_t numaddrs)
+{
+  thread writer([=]() { bf_touch_cache(baseaddr, numaddrs, 1); });
+  writer.join();
+}
+
+int main (void)
+{
+  bf_cache_model = 1;
+  bf_line_size = 256;
+  bf_max_set_bits = 1;
+  bf_test_initialize();
+
+  // Ten lines are falsely shared once each by writers of disjoint words.
+  const uint64_t base = 0x100000;
+  for (uint64_t line = 0; line < 10; line++) {
+    store_from_thread(base + line*256, 8);
+    store_from_thread(base + line*256 + 8, 8);
+  }
+
+  // One more line sees two false-sharing transfers, with byte masks that
+  // span several words, followed by a true-sharing transfer that overlaps
+  // the previous writer in a single byte.
+  const uint64_t line = base + 10*256;
+  store_from_thread(line, 130);
+  store_from_thread(line + 130, 126);
+  store_from_thread(line + 127, 2);
+  store_from_thread(line + 128, 2);
+  return 0;
+}
@@ -0,0 +1,19 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the cache model         #
+# distinguishes false from true       #
+# sharing                             #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Store to lines from a succession of threads, and check the counts the
+# sharing detector reports.
+output=`env BF_CACHE_SHARING=1 ./cache-sharing`
+echo "$output" | grep -q ' 11 cache lines falsely shared (12 transfers between writers)'
+echo "$output" | grep -q ' 1 cache lines truly shared (1 transfers between writers)'
@@ -0,0 +1,143 @@
+/*
+ * Check the cache model's write-allocate fills and write-backs against a
+ * simple reference model of write-back caches.  The first argument names
+ * the trace to replay.
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cstring>
+#include <list>
+#include <random>
+#include "bftest.h"
+
+// Model a write-back, write-allocate cache with LRU replacement.
+class ReferenceCache {
+public:
+  ReferenceCache(uint64_t set_bits, uint64_t ways) :
+    sets(uint64_t(1) << set_bits), ways(ways), fills(0), writebacks(0) { }
+
+  // Access a line, filling it on a store miss and writing back the line it
+  // evicts if that line is dirty.
+  void access (uint64_t line, bool is_store) {
+    list<pair<uint64_t, bool> >& stack = sets[line % sets.size()];
+    for (auto iter = stack.begin(); iter != stack.end(); iter++)
+      if (iter->first == line) {
+        bool dirty = iter->second || is_store;
+        stack.erase(iter);
+        stack.push_front(make_pair(line, dirty));
+        return;
+      }
+    fills += is_store;
+    stack.push_front(make_pair(line, is_store));
+    if (stack.size() > ways) {
+      writebacks += stack.back().second;
+      stack.pop_back();
+    }
+  }
+
+  // Return the number of dirty lines the cache holds.
+  uint64_t count_dirty (void) const {
+    uint64_t dirty = 0;
+    for (auto& stack: sets)
+      for (auto& line: stack)
+        dirty += line.second;
+    return dirty;
+  }
+
+  vector<list<pair<uint64_t, bool> > > sets;  // MRU first
+  uint64_t ways;         // Maximum lines per set
+  uint64_t fills;        // Write-allocate fills
+  uint64_t writebacks;   // Dirty lines evicted
+};
+
+// Access a range of bytes in both the cache model and a set of reference
+// caches.
+static void touch (vector<ReferenceCache>& ref, uint64_t addr, uint64_t nbytes,
+                   bool is_store)
+{
+  bf_touch_cache(addr, nbytes, uint8_t(is_store));
+  for (uint64_t line = addr/64; line <= (addr + nbytes - 1)/64; line++)
+    for (auto& cache: ref)
+      cache.access(line, is_store);
+}
+
+// Replay a trace of mixed loads and stores, some of which straddle two
+// lines.
+static void mixed_trace (vector<ReferenceCache>& ref)
+{
+  mt19937_64 rng(1);
+  const uint64_t base = 0x100000;
+  for (int i = 0; i < 20000; i++) {
+    uint64_t addr;
+    if (rng() % 2 == 0)
+      addr = base + (rng() % 32)*64 + rng() % 64;
+    else
+      addr = base + (rng() % 1024)*64 + rng() % 64;
+    uint64_t nbytes = 1 + rng() % 8;
+    touch(ref, addr, nbytes, rng() % 3 == 0);
+  }
+}
+
+// Read one array and write another once each, as a streaming kernel does.
+// Every stored line is evicted without being accessed again, except those
+// that the larger caches still hold at the end.
+static void stream_trace (vector<ReferenceCache>& ref)
+{
+  const uint64_t src = 0x100000;
+  const uint64_t dst = 0x900000;
+  for (uint64_t ofs = 0; ofs < 4096*64; ofs += 8) {
+    touch(ref, src + ofs, 8, false);
+    touch(ref, dst + ofs, 8, true);
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  static const struct {
+    const char* name;
+    void (*run)(vector<ReferenceCache>&);
+  } cases[] = {
+    {"mixed",  mixed_trace},
+    {"stream", stream_trace}
+  };
+  void (*run)(vector<ReferenceCache>&) = nullptr;
+  if (argc == 2)
+    for (auto& test_case: cases)
+      if (strcmp(argv[1], test_case.name) == 0)
+        run = test_case.run;
+  if (run == nullptr) {
+    cerr << "Usage: " << argv[0] << " <case>\n";
+    return 1;
+  }
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 5;
+  bf_test_initialize();
+
+  // Run the trace through the cache model and through reference caches of
+  // every power-of-two associativity the model reports.
+  vector<ReferenceCache> ref;
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2)
+      ref.push_back(ReferenceCache(set, ways));
+  run(ref);
+
+  // The private and shared caches both saw the same traffic as the
+  // reference caches.
+  size_t idx = 0;
+  for (uint64_t set = 0; set < bf_max_set_bits; set++)
+    for (uint64_t ways = 1; ways < LogHistogram::exact_limit; ways *= 2, idx++) {
+      uint64_t fills, writebacks, dirty;
+      uint64_t ref_dirty = ref[idx].count_dirty();
+      bf_get_private_write_traffic(set, ways, &fills, &writebacks, &dirty);
+      BF_CHECK(fills == ref[idx].fills);
+      BF_CHECK(writebacks == ref[idx].writebacks);
+      BF_CHECK(dirty == ref_dirty);
+      bf_get_shared_write_traffic(set, ways, &fills, &writebacks, &dirty);
+      BF_CHECK(fills == ref[idx].fills);
+      BF_CHECK(writebacks == ref[idx].writebacks);
+      BF_CHECK(dirty == ref_dirty);
+    }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the cache model counts  #
+# write-allocate fills and            #
+# write-backs correctly               #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Replay each trace through each LRU stack-distance engine.
+for engine in linear tree ; do
+  for case in mixed stream ; do
+    env BF_CACHE_ENGINE=$engine ./cache-writes $case
+  done
+done
@@ -0,0 +1,84 @@
+/*
+ * Compare the speed of FlatAddrMap with that of CachedUnorderedMap on the
+ * access pattern of the reuse-distance calculator's last-access map.  This
+ * is not run by "make check"; build it with "make flatmap-bench".
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <chrono>
+#include <random>
+#include "bftest.h"
+#include "cachemap.h"
+#include "flatmap.h"
+
+// Generate a trace of addresses that mostly revisit a working set of
+// recent addresses but occasionally touch a new one, as a program's loads
+// and stores do.
+static vector<uint64_t> make_trace (size_t length, size_t working_set)
+{
+  vector<uint64_t> trace;
+  trace.reserve(length);
+  mt19937_64 rng(1);
+  uint64_t next_new = 0x10000000;
+  for (size_t i = 0; i < length; i++)
+    if (i < working_set || rng() % 16 == 0) {
+      trace.push_back(next_new);
+      next_new += 8;
+    }
+    else
+      trace.push_back(trace[i - 1 - rng() % working_set]);
+  return trace;
+}
+
+// Replay a trace through a map as the reuse-distance calculator does:
+// look up each address's last access time, then update it.  Every so
+// often, erase the oldest addresses, as pruning would.  Return the elapsed
+// time in seconds and a checksum that keeps the work from being optimized
+// away.
+template<class Map>
+static double replay (const vector<uint64_t>& trace, size_t prune_lag, uint64_t* checksum)
+{
+  Map last_access;
+  uint64_t sum = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t clock = 0; clock < trace.size(); clock++) {
+    auto iter = last_access.find(trace[clock]);
+    if (iter != last_access.end()) {
+      sum += clock - iter->second;
+      iter->second = clock;
+    }
+    else
+      last_access[trace[clock]] = clock;
+    if (clock >= prune_lag && clock % 64 == 0)
+      for (size_t old = clock - prune_lag; old < clock - prune_lag + 64; old++)
+        last_access.erase(trace[old]);
+  }
+  auto stop = chrono::steady_clock::now();
+  *checksum = sum + last_access.size();
+  return chrono::duration<double>(stop - start).count();
+}
+
+int main (int argc, char* argv[])
+{
+  size_t length = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000000;
+  size_t working_set = argc > 2 ? strtoull(argv[2], nullptr, 10) : 100000;
+  size_t prune_lag = 4*working_set;
+  vector<uint64_t> trace(make_trace(length, working_set));
+
+  uint64_t flat_sum, cached_sum;
+  double flat_secs = replay<FlatAddrMap<uint64_t> >(trace, prune_lag, &flat_sum);
+  double cached_secs = replay<CachedUnorderedMap<uint64_t, uint64_t> >(trace, prune_lag, &cached_sum);
+  if (flat_sum != cached_sum) {
+    cerr << argv[0] << ": maps disagree\n";
+    return 1;
+  }
+  cout << "Accesses:           " << length << '\n'
+       << "Working set:        " << working_set << '\n'
+       << "FlatAddrMap:        " << flat_secs << " s ("
+       << flat_secs*1e9/double(length) << " ns/access)\n"
+       << "CachedUnorderedMap: " << cached_secs << " s ("
+       << cached_secs*1e9/double(length) << " ns/access)\n"
+       << "Speedup:            " << cached_secs/flat_secs << "x\n";
+  return 0;
+}
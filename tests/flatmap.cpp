@@ -0,0 +1,77 @@
+/*
+ * Check FlatAddrMap against an unordered_map under a random mix of
+ * insertions, lookups, and erasures
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <random>
+#include "bftest.h"
+#include "flatmap.h"
+
+// Ensure that a FlatAddrMap holds exactly the pairs a reference map holds.
+static void check_same (const FlatAddrMap<uint64_t>& flat,
+                        const unordered_map<uint64_t, uint64_t>& ref)
+{
+  BF_CHECK(flat.size() == ref.size());
+  size_t visited = 0;
+  for (auto iter = flat.begin(); iter != flat.end(); iter++, visited++) {
+    auto ref_iter = ref.find(iter->first);
+    BF_CHECK(ref_iter != ref.end());
+    BF_CHECK(ref_iter->second == iter->second);
+  }
+  BF_CHECK(visited == ref.size());
+}
+
+int main (void)
+{
+  bf_test_initialize();
+
+  // Draw keys from a small range so that probe sequences collide, wrap
+  // around the end of the table, and are repeatedly punched full of holes
+  // by erase().  Include the key that marks empty slots.
+  mt19937_64 rng(1);
+  FlatAddrMap<uint64_t> flat;
+  unordered_map<uint64_t, uint64_t> ref;
+  for (int i = 0; i < 200000; i++) {
+    uint64_t key;
+    switch (rng() % 8) {
+      case 0:
+        key = ~uint64_t(0);
+        break;
+      case 1:
+        key = rng();
+        break;
+      default:
+        key = rng() % 4096;
+        break;
+    }
+    switch (rng() % 3) {
+      case 0:
+        flat[key] = uint64_t(i);
+        ref[key] = uint64_t(i);
+        break;
+      case 1:
+        BF_CHECK(flat.erase(key) == ref.erase(key));
+        break;
+      default: {
+        auto iter = flat.find(key);
+        auto ref_iter = ref.find(key);
+        BF_CHECK((iter == flat.end()) == (ref_iter == ref.end()));
+        if (iter != flat.end())
+          BF_CHECK(iter->second == ref_iter->second);
+        break;
+      }
+    }
+    if (i % 10000 == 0)
+      check_same(flat, ref);
+  }
+  check_same(flat, ref);
+
+  // Erasing every key empties the map.
+  for (auto& pair: ref)
+    BF_CHECK(flat.erase(pair.first) == 1);
+  BF_CHECK(flat.size() == 0);
+  BF_CHECK(flat.begin() == flat.end());
+  return 0;
+}
@@ -0,0 +1,15 @@
+#! /bin/sh
+
+#######################################
+# Ensure that FlatAddrMap behaves     #
+# like an unordered_map               #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Replay a random mix of insertions, lookups, and erasures.
+./flatmap
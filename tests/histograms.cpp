@@ -0,0 +1,80 @@
+/*
+ * Check the binning shared by LogHistogram and HdrHistogram
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include "bftest.h"
+
+// Ensure that a histogram's bins tile the 64-bit values without gaps or
+// overlaps and that no bin is wider than its precision allows.
+template<class Histogram>
+static void check_bins (const Histogram& hist, size_t num_bins,
+                        unsigned exact_bits, unsigned sub_bin_bits)
+{
+  BF_CHECK(hist.bin_min(0) == 0);
+  for (size_t bin = 0; bin < num_bins; bin++) {
+    uint64_t lo = hist.bin_min(bin);
+    uint64_t hi = hist.bin_max(bin);
+    BF_CHECK(lo <= hi);
+    BF_CHECK(hist.bin_of(lo) == bin);
+    BF_CHECK(hist.bin_of(hi) == bin);
+    BF_CHECK(hist.bin_of(lo + (hi - lo)/2) == bin);
+    if (lo < uint64_t(1) << exact_bits)
+      BF_CHECK(lo == hi);
+    else
+      BF_CHECK(hi - lo + 1 <= lo >> sub_bin_bits);
+    if (bin + 1 < num_bins)
+      BF_CHECK(hist.bin_min(bin + 1) == hi + 1);
+    else
+      BF_CHECK(hi == ~uint64_t(0));
+  }
+}
+
+int main (void)
+{
+  bf_test_initialize();
+
+  // LogHistogram has a fixed precision and a fixed number of bins.
+  LogHistogram log_hist;
+  check_bins(log_hist, LogHistogram::num_bins,
+             LogHistogram::exact_bits, LogHistogram::sub_bin_bits);
+  log_hist.increment(5);
+  log_hist.increment(1000, 3);
+  log_hist.increment(~uint64_t(0));
+  BF_CHECK(log_hist.count_at_most(5) == 1);
+  BF_CHECK(log_hist.count_at_most(1000) == 4);
+  BF_CHECK(log_hist.count_above(1000) == 1);
+  BF_CHECK(LogHistogram::exact_at(LogHistogram::exact_limit - 1));
+  BF_CHECK(!LogHistogram::exact_at(LogHistogram::exact_limit));
+  BF_CHECK(!LogHistogram::exact_at(1000));
+  BF_CHECK(LogHistogram::exact_at(LogHistogram::bin_max(LogHistogram::bin_of(1000))));
+  LogHistogram log_sum;
+  log_sum += log_hist;
+  log_sum += log_hist;
+  BF_CHECK(log_sum[LogHistogram::bin_of(1000)] == 6);
+
+  // HdrHistogram's precision is chosen at run time, and it allocates bins
+  // only as needed.
+  for (unsigned bits = 0; bits <= 10; bits++) {
+    HdrHistogram hdr_hist(bits);
+    size_t num_bins = hdr_hist.bin_of(~uint64_t(0)) + 1;
+    check_bins(hdr_hist, num_bins, bits + 1, bits);
+    BF_CHECK(hdr_hist.get_exact_limit() == uint64_t(2) << bits);
+    BF_CHECK(hdr_hist.get_sub_bins() == uint64_t(1) << bits);
+    BF_CHECK(hdr_hist.size() == 0);
+    hdr_hist.increment(1000, 2);
+    BF_CHECK(hdr_hist.size() == hdr_hist.bin_of(1000) + 1);
+    BF_CHECK(hdr_hist[hdr_hist.bin_of(1000)] == 2);
+    BF_CHECK(hdr_hist[num_bins - 1] == 0);
+    HdrHistogram hdr_sum(bits);
+    hdr_sum.increment(3);
+    hdr_sum += hdr_hist;
+    BF_CHECK(hdr_sum.size() == hdr_hist.size());
+    BF_CHECK(hdr_sum[hdr_sum.bin_of(3)] == 1);
+    BF_CHECK(hdr_sum[hdr_sum.bin_of(1000)] == 2);
+    hdr_sum.reset();
+    BF_CHECK(hdr_sum.size() == 0);
+  }
+  return 0;
+}
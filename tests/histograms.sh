@@ -0,0 +1,15 @@
+#! /bin/sh
+
+#######################################
+# Ensure that Byfl's log-binned       #
+# histograms tile the 64-bit values   #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Check every bin of every supported precision.
+./histograms
@@ -0,0 +1,61 @@
+/*
+ * Check that HyperLogLog estimates stay within their error bounds
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cmath>
+#include "bftest.h"
+
+// Return true if an estimate lies within four standard errors of the truth
+// (or within one for very small counts, which linear counting handles
+// almost exactly).
+static bool close_enough (uint64_t estimate, uint64_t truth, unsigned bits)
+{
+  double slack = 4.0*HyperLogLog::relative_error(bits)*double(truth);
+  if (slack < 1.0)
+    slack = 1.0;
+  return fabs(double(estimate) - double(truth)) <= slack;
+}
+
+int main (void)
+{
+  bf_test_initialize();
+
+  // Insert increasing numbers of consecutive addresses, as a function
+  // sweeping an array would, into sketches of various precisions.
+  for (unsigned bits = HyperLogLog::min_precision; bits <= HyperLogLog::max_precision; bits += 2) {
+    HyperLogLog sketch(bits);
+    uint64_t inserted = 0;
+    for (uint64_t target = 10; target <= 1000000; target *= 10) {
+      sketch.insert_range(0x10000000 + inserted, target - inserted);
+      inserted = target;
+      BF_CHECK(close_enough(sketch.estimate(), inserted, bits));
+    }
+
+    // Reinserting keys changes nothing.
+    uint64_t before = sketch.estimate();
+    sketch.insert_range(0x10000000, 1000);
+    BF_CHECK(sketch.estimate() == before);
+
+    // Merging sketches of disjoint ranges estimates their union.
+    HyperLogLog other(bits);
+    other.insert_range(0x90000000, 500000);
+    sketch.merge(other);
+    BF_CHECK(close_enough(sketch.estimate(), 1500000, bits));
+  }
+
+  // At cache-line granularity, each line touched counts as 64 bytes no
+  // matter how many of its bytes were touched.
+  HyperLogLog lines(14, 64);
+  for (uint64_t line = 0; line < 100000; line++)
+    lines.insert_range(0x10000000 + line*64 + line%60, 1 + line%4);
+  BF_CHECK(close_enough(lines.estimate(), 100000*64, 14));
+  HyperLogLog one_line(14, 64);
+  one_line.insert_range(0x10000010, 8);
+  one_line.insert_range(0x10000020, 32);
+  BF_CHECK(one_line.estimate() == 64);
+  one_line.insert_range(0x1000003c, 8);
+  BF_CHECK(one_line.estimate() == 128);
+  return 0;
+}
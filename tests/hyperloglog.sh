@@ -0,0 +1,16 @@
+#! /bin/sh
+
+#######################################
+# Ensure that HyperLogLog sketches    #
+# estimate unique bytes within their  #
+# error bounds                        #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Insert known numbers of unique addresses and check the estimates.
+./hyperloglog
@@ -0,0 +1,25 @@
+/***********************************
+ * Fill and copy a buffer with     *
+ * memset, memcpy, and memmove     *
+ *                                 *
+ * By Scott Pakin <pakin@lanl.gov> *
+ ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main (int argc, char *argv[])
+{
+  size_t nbytes = argc > 1 ? (size_t) atol(argv[1]) : 1048576;
+  char *src = malloc(nbytes);
+  char *dst = malloc(nbytes);
+
+  memset(src, argc, nbytes);
+  memcpy(dst, src, nbytes);
+  memmove(dst + 1, dst, nbytes - 1);
+  printf("Last byte is %d\n", dst[nbytes - 1]);
+  free(dst);
+  free(src);
+  return 0;
+}
@@ -0,0 +1,310 @@
+/*
+ * Check Byfl's page tables against a simple reference model.  The first
+ * argument names the case to run.
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include "bftest.h"
+#include "pagetable.h"
+
+// Draw a random range of addresses, mostly clustered on a few pages but
+// sometimes far beyond what a radix tree covers or straddling pages.
+static void random_range (mt19937_64& rng, uint64_t* baseaddr, uint64_t* numaddrs)
+{
+  switch (rng() % 4) {
+    case 0:
+      *baseaddr = (uint64_t(1) << 60) + rng() % 100000;
+      break;
+    case 1:
+      *baseaddr = 0x7fff0000 + 8192*(rng() % 4) - rng() % 64;
+      break;
+    default:
+      *baseaddr = 0x10000 + rng() % 50000;
+      break;
+  }
+  *numaddrs = 1 + rng() % 100;
+}
+
+// Both page maps record exactly the bytes a reference set does.
+static void check_maps (void)
+{
+  bf_test_initialize();
+  BitPageTable radix_table(8192);
+  SparseBitPageTable hash_table(8192);
+  WordPageTable word_table(8192);
+  unordered_set<uint64_t> ref;
+  mt19937_64 rng(1);
+  for (int i = 0; i < 20000; i++) {
+    uint64_t baseaddr, numaddrs;
+    random_range(rng, &baseaddr, &numaddrs);
+    uint64_t new_bytes = 0;
+    for (uint64_t addr = baseaddr; addr < baseaddr + numaddrs; addr++)
+      new_bytes += ref.insert(addr).second;
+    BF_CHECK(radix_table.access(baseaddr, numaddrs) == new_bytes);
+    BF_CHECK(hash_table.access(baseaddr, numaddrs) == new_bytes);
+    BF_CHECK(word_table.access(baseaddr, numaddrs) == new_bytes);
+  }
+  BF_CHECK(radix_table.tally_unique() == ref.size());
+  BF_CHECK(hash_table.tally_unique() == ref.size());
+  BF_CHECK(word_table.tally_unique() == ref.size());
+
+  // Either map can be merged into the other.
+  BitPageTable radix_merged(8192);
+  radix_merged.merge(&hash_table);
+  BF_CHECK(radix_merged.tally_unique() == ref.size());
+  SparseBitPageTable hash_merged(8192);
+  hash_merged.merge(&radix_table);
+  BF_CHECK(hash_merged.tally_unique() == ref.size());
+}
+
+// Return the number of bytes present in both of two reference sets.
+static uint64_t count_common (const unordered_set<uint64_t>& a,
+                              const unordered_set<uint64_t>& b)
+{
+  uint64_t common = 0;
+  for (auto addr: a)
+    common += b.count(addr);
+  return common;
+}
+
+// Compare every counter of a word page table to a reference count.
+static void check_counts (WordPageTable& table,
+                          const unordered_map<uint64_t, uint64_t>& ref)
+{
+  uint64_t num_touched = 0;
+  for (auto& page: table)
+    for (size_t pos = 0; pos < 8192; pos++) {
+      auto iter = ref.find(page.first*8192 + pos);
+      uint64_t expected = iter == ref.end() ? 0 : iter->second;
+      BF_CHECK(page.second->count_at(pos) == expected);
+      num_touched += expected > 0;
+    }
+  BF_CHECK(num_touched == ref.size());
+  BF_CHECK(table.tally_unique() == ref.size());
+}
+
+// Access random ranges plus half of the page at 0x100000 in a bit and a word
+// page table and in their reference models.
+static void fill_tables (mt19937_64& rng, uint64_t half,
+                         BitPageTable* bit_table, WordPageTable* word_table,
+                         unordered_set<uint64_t>* ref_bits,
+                         unordered_map<uint64_t, uint64_t>* ref_counts)
+{
+  for (int i = 0; i <= 5000; i++) {
+    uint64_t baseaddr, numaddrs;
+    if (i < 5000)
+      random_range(rng, &baseaddr, &numaddrs);
+    else {
+      baseaddr = 0x100000 + half*4096;
+      numaddrs = 4096;
+    }
+    bit_table->access(baseaddr, numaddrs);
+    word_table->access(baseaddr, numaddrs);
+    for (uint64_t addr = baseaddr; addr < baseaddr + numaddrs; addr++) {
+      ref_bits->insert(addr);
+      (*ref_counts)[addr]++;
+    }
+  }
+}
+
+// Merging and marking pages a word at a time agrees with merging the
+// reference sets a byte at a time, including when a merge fills a page.
+static void check_merge (void)
+{
+  bf_test_initialize();
+  BitPageTable bit_table(8192), other_bit_table(8192);
+  WordPageTable word_table(8192), other_word_table(8192);
+  unordered_set<uint64_t> ref_bits, other_ref_bits;
+  unordered_map<uint64_t, uint64_t> ref_counts, other_ref_counts;
+  mt19937_64 rng(1);
+  fill_tables(rng, 0, &bit_table, &word_table, &ref_bits, &ref_counts);
+  fill_tables(rng, 1, &other_bit_table, &other_word_table,
+              &other_ref_bits, &other_ref_counts);
+  BF_CHECK(other_bit_table.tally_unique() == other_ref_bits.size());
+  check_counts(other_word_table, other_ref_counts);
+
+  // Merge the other table of each kind into the first, marking the bytes
+  // both touched.  The two halves of the page at 0x100000 fill it.
+  BitPageTable shared(8192);
+  uint64_t common = count_common(ref_bits, other_ref_bits);
+  bit_table.merge(&other_bit_table, &shared);
+  BF_CHECK(shared.tally_unique() == common);
+  for (auto addr: other_ref_bits)
+    ref_bits.insert(addr);
+  BF_CHECK(bit_table.tally_unique() == ref_bits.size());
+  BF_CHECK(bit_table.access(0x100000, 8192) == 0);
+  word_table.merge(&other_word_table);
+  for (auto& count: other_ref_counts)
+    ref_counts[count.first] += count.second;
+  check_counts(word_table, ref_counts);
+
+  // Marking a page with a table's own bits adds nothing, but marking an
+  // empty table with them copies them.
+  vector<uint64_t> bits(8192/64);
+  BitPageTable marked(8192);
+  for (auto& page: other_bit_table) {
+    page.second->touched_bits(bits.data());
+    bit_table.mark(page.first, bits.data());
+    marked.mark(page.first, bits.data());
+  }
+  BF_CHECK(bit_table.tally_unique() == ref_bits.size());
+  BF_CHECK(marked.tally_unique() == other_ref_bits.size());
+}
+
+// Ranges that span many pages, as memset and memcpy produce, are marked a
+// page at a time with the same result as marking them a byte at a time.
+static void check_ranges (void)
+{
+  bf_test_initialize();
+  BitPageTable bit_table(8192);
+  WordPageTable word_table(8192);
+  const uint64_t base = 0x7ff00000 - 100;
+  const uint64_t region = uint64_t(1) << 20;
+  vector<uint32_t> ref(region, 0);
+  uint64_t ref_unique = 0;
+  mt19937_64 rng(1);
+  for (int i = 0; i < 2000; i++) {
+    uint64_t numaddrs = 1 + rng() % 65536;
+    uint64_t offset = rng() % (region - numaddrs + 1);
+    uint64_t new_bytes = 0;
+    for (uint64_t ofs = offset; ofs < offset + numaddrs; ofs++)
+      new_bytes += ref[ofs]++ == 0;
+    ref_unique += new_bytes;
+    BF_CHECK(bit_table.access(base + offset, numaddrs) == new_bytes);
+    BF_CHECK(word_table.access(base + offset, numaddrs) == new_bytes);
+  }
+  BF_CHECK(bit_table.tally_unique() == ref_unique);
+  BF_CHECK(word_table.tally_unique() == ref_unique);
+  for (auto& page: word_table)
+    for (size_t pos = 0; pos < 8192; pos++) {
+      uint64_t addr = page.first*8192 + pos;
+      uint64_t expected = addr >= base && addr < base + region ? ref[addr - base] : 0;
+      BF_CHECK(page.second->count_at(pos) == expected);
+    }
+}
+
+// Model a WordPageTableEntry's counters with unbounded ones, clamping each
+// at the maximum word value.
+class ReferenceCounters {
+public:
+  ReferenceCounters() : counts(8192, 0) { }
+
+  // Increment the counters in a range of positions.
+  void increment (size_t pos1, size_t pos2) {
+    for (size_t pos = pos1; pos <= pos2; pos++)
+      counts[pos] = min(counts[pos] + 1, uint64_t(bf_max_bytecount));
+  }
+
+  // Add another set of counters to ours.
+  void merge (const ReferenceCounters& other) {
+    for (size_t pos = 0; pos < counts.size(); pos++)
+      counts[pos] = min(counts[pos] + other.counts[pos], uint64_t(bf_max_bytecount));
+  }
+
+  // Ensure that a page-table entry holds the same counts as we do.
+  void check (const WordPageTableEntry& entry) const {
+    size_t touched = 0;
+    for (size_t pos = 0; pos < counts.size(); pos++) {
+      BF_CHECK(entry.count_at(pos) == counts[pos]);
+      touched += counts[pos] > 0;
+    }
+    BF_CHECK(entry.count() == touched);
+  }
+
+  vector<uint64_t> counts;   // One counter per byte on the page
+};
+
+// Small counters that overflow keep their full counts, pages whose counters
+// overflow often switch to full-width counters, and all counts saturate at
+// the maximum word value, whether incremented or merged.
+static void check_counters (void)
+{
+  bf_test_initialize();
+
+  // Increment a few bytes and a vector's worth of bytes past the point at
+  // which small counters overflow.
+  WordPageTableEntry entry(8192);
+  ReferenceCounters ref;
+  for (int i = 0; i < 300; i++) {
+    entry.increment(5, 5);
+    ref.increment(5, 5);
+    entry.increment(64, 64 + 31);
+    ref.increment(64, 64 + 31);
+    entry.increment(1000 + i, 1000 + i + 20);
+    ref.increment(1000 + i, 1000 + i + 20);
+  }
+  ref.check(entry);
+
+  // Merge small counters whose sums do or do not overflow.
+  WordPageTableEntry other(8192);
+  ReferenceCounters other_ref;
+  for (int i = 0; i < 200; i++) {
+    other.increment(0, 127);
+    other_ref.increment(0, 127);
+  }
+  entry.merge(&other);
+  ref.merge(other_ref);
+  ref.check(entry);
+
+  // Overflow so many counters that the page widens, then keep incrementing
+  // and merging in both directions.
+  for (int i = 0; i < 260; i++) {
+    other.increment(2048, 2048 + 2047);
+    other_ref.increment(2048, 2048 + 2047);
+  }
+  other_ref.check(other);
+  WordPageTableEntry small_copy(entry);
+  ReferenceCounters small_copy_ref(ref);
+  entry.merge(&other);
+  ref.merge(other_ref);
+  ref.check(entry);
+  other.merge(&small_copy);
+  other_ref.merge(small_copy_ref);
+  other_ref.check(other);
+  other.increment(0, 8191);
+  other_ref.increment(0, 8191);
+  other_ref.check(other);
+
+  // Double a page's counts by merging it with a copy of itself until they
+  // saturate, both with small counters and with full-width counters.
+  WordPageTableEntry* pages[2] = {&small_copy, &other};
+  ReferenceCounters* page_refs[2] = {&small_copy_ref, &other_ref};
+  for (int p = 0; p < 2; p++) {
+    for (int i = 0; i < 33; i++) {
+      WordPageTableEntry copy(*pages[p]);
+      pages[p]->merge(&copy);
+      page_refs[p]->merge(*page_refs[p]);
+    }
+    page_refs[p]->check(*pages[p]);
+    BF_CHECK(pages[p]->count_at(5) == bf_max_bytecount);
+    pages[p]->increment(0, 8191);
+    page_refs[p]->increment(0, 8191);
+    page_refs[p]->check(*pages[p]);
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  static const struct {
+    const char* name;
+    void (*run)(void);
+  } cases[] = {
+    {"maps",     check_maps},
+    {"merge",    check_merge},
+    {"counters", check_counters},
+    {"ranges",   check_ranges}
+  };
+  if (argc == 2)
+    for (auto& test_case: cases)
+      if (strcmp(argv[1], test_case.name) == 0) {
+        test_case.run();
+        return 0;
+      }
+  cerr << "Usage: " << argv[0] << " <case>\n";
+  return 1;
+}
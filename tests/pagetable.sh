@@ -0,0 +1,35 @@
+#! /bin/sh
+
+#######################################
+# Ensure that Byfl's page tables      #
+# record exactly the bytes touched    #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Run each case in a fresh process because some configure the run-time
+# library differently.
+for case in maps merge counters ranges ; do
+  ./pagetable $case
+done
+
+# Keep word-page counters in a file-backed arena that is trimmed every
+# 64 KB, and ensure that the counters survive trimming and that the file is
+# unlinked.
+rm -rf pagetable.dir
+mkdir pagetable.dir
+for case in merge counters ranges ; do
+  env BF_PAGE_TABLE_DIR=pagetable.dir BF_PAGE_TABLE_RESIDENT=64K ./pagetable $case
+done
+test -z "`ls pagetable.dir`"
+rmdir pagetable.dir
+
+# Resident limits must be a number of bytes.
+if env BF_PAGE_TABLE_DIR=. BF_PAGE_TABLE_RESIDENT=64Q ./pagetable counters 2> pagetable.err ; then
+  exit 1
+fi
+grep -q 'BF_PAGE_TABLE_RESIDENT must be a number of bytes' pagetable.err
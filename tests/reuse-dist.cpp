@@ -0,0 +1,358 @@
+/*
+ * Check the reuse-distance model against known answers.  The first
+ * argument names the case to run.
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include "bftest.h"
+#include "reuse-dist.h"
+
+// Touch a single address.
+static void touch (uint64_t address)
+{
+  bf_reuse_dist_addrs_prog(address, 1);
+}
+
+// A maximum reuse distance smaller than the sample period still finds
+// back-to-back reuse.
+static void check_short_window (void)
+{
+  bf_max_reuse_distance = 1;
+  bf_sample_period = 4;
+  bf_test_initialize();
+  for (uint64_t address = 0; address < 4000; address++) {
+    touch(address);
+    touch(address);
+  }
+  HdrHistogram* hist;
+  uint64_t unique_addrs, sampled_addrs, total_addrs;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  bf_get_reuse_sampling(&sampled_addrs, &total_addrs);
+  BF_CHECK(total_addrs == 8000);
+  BF_CHECK(sampled_addrs > 0);
+  BF_CHECK((*hist)[0]*2 == sampled_addrs);
+  BF_CHECK(unique_addrs == sampled_addrs/2*bf_sample_period);
+}
+
+// Sampling one address in eight and scaling up the results approximates
+// the unique bytes and median reuse distance of a cyclic sweep.
+static void check_sampling (void)
+{
+  bf_sample_period = 8;
+  bf_test_initialize();
+  for (int pass = 0; pass < 3; pass++)
+    for (uint64_t address = 0; address < 100000; address++)
+      touch(0x1000000 + address);
+  HdrHistogram* hist;
+  uint64_t unique_addrs, sampled_addrs, total_addrs, median_value, mad_value;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  bf_get_reuse_sampling(&sampled_addrs, &total_addrs);
+  bf_get_median_reuse_distance(&median_value, &mad_value);
+  BF_CHECK(total_addrs == 300000);
+  BF_CHECK(sampled_addrs > 300000/8*9/10 && sampled_addrs < 300000/8*11/10);
+  BF_CHECK(unique_addrs > 90000 && unique_addrs < 110000);
+  BF_CHECK(median_value > 90000 && median_value < 110000);
+}
+
+// Return the total tally of a histogram.
+static uint64_t total_tally (const HdrHistogram& hist)
+{
+  uint64_t total = 0;
+  for (size_t bin = 0; bin < hist.size(); bin++)
+    total += hist[bin];
+  return total;
+}
+
+// At word granularity, a reuse distance counts the distinct words touched
+// in between, and an access that spans two words touches both.
+static void check_granularity (void)
+{
+  bf_reuse_granularity = 8;
+  bf_test_initialize();
+  for (uint64_t word = 0; word < 100; word++)
+    bf_reuse_dist_addrs_prog(word*8, 8);
+  for (uint64_t word = 0; word < 100; word++)
+    bf_reuse_dist_addrs_prog(word*8 + 2, 4);
+  bf_reuse_dist_addrs_prog(4, 8);
+  HdrHistogram* hist;
+  uint64_t unique_addrs, median_value, mad_value;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  bf_get_median_reuse_distance(&median_value, &mad_value);
+  BF_CHECK(total_tally(*hist) == 102);
+  BF_CHECK((*hist)[hist->bin_of(99)] == 102);
+  BF_CHECK(unique_addrs == 800);
+  BF_CHECK(median_value == 99*8);
+  BF_CHECK(mad_value == 0);
+}
+
+// The reuse-distance tree agrees with a brute-force calculation, also
+// while -bf-max-rdist pruning recycles the tree's nodes.
+static void check_exact (void)
+{
+  bf_max_reuse_distance = 1000;
+  bf_test_initialize();
+  map<uint64_t, uint64_t> last_access;   // Address -> time, pruned as by the tree
+  HdrHistogram ref_hist(static_cast<unsigned>(bf_reuse_bin_bits));
+  uint64_t ref_unique = 0;
+  mt19937_64 rng(1);
+  for (uint64_t clock = 0; clock < 50000; clock++) {
+    uint64_t address = rng() % 4 == 0 ? rng() % 2000 : rng() % 100;
+    touch(address);
+    auto iter = last_access.find(address);
+    if (iter == last_access.end())
+      ref_unique++;
+    else {
+      uint64_t distance = 0;
+      for (auto& entry: last_access)
+        distance += entry.second > iter->second;
+      ref_hist.increment(distance);
+    }
+    last_access[address] = clock;
+    if (last_access.size() > bf_max_reuse_distance) {
+      for (iter = last_access.begin(); iter != last_access.end(); )
+        if (iter->second < clock + 1 - bf_max_reuse_distance)
+          iter = last_access.erase(iter);
+        else
+          iter++;
+    }
+  }
+  HdrHistogram* hist;
+  uint64_t unique_addrs;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  BF_CHECK(unique_addrs == ref_unique);
+  BF_CHECK(hist->size() == ref_hist.size());
+  for (size_t bin = 0; bin < ref_hist.size(); bin++)
+    BF_CHECK((*hist)[bin] == ref_hist[bin]);
+}
+
+// The approximate tree's distances lie within its relative error bound of
+// the exact distances, though not all are exact.
+static void check_approx (void)
+{
+  const double max_error = 0.05;
+  ApproxRDtree tree(max_error);
+  uint64_t num_inexact = 0;
+  map<uint64_t, uint64_t> last_access;   // Address -> time
+  set<uint64_t> live_times;              // Values of last_access
+  mt19937_64 rng(1);
+  for (uint64_t clock = 0; clock < 50000; clock++) {
+    uint64_t address = rng() % 4 == 0 ? rng() % 3000 : rng() % 200;
+    auto iter = last_access.find(address);
+    if (iter != last_access.end()) {
+      uint64_t prev_time = iter->second;
+      uint64_t exact = uint64_t(distance(live_times.upper_bound(prev_time),
+                                         live_times.end()));
+      uint64_t approx = tree.remove(prev_time);
+      uint64_t error = approx > exact ? approx - exact : exact - approx;
+      BF_CHECK(double(error) <= max_error*double(exact));
+      num_inexact += error > 0;
+      live_times.erase(prev_time);
+    }
+    last_access[address] = clock;
+    live_times.insert(clock);
+    tree.insert(clock, 0);
+  }
+  BF_CHECK(num_inexact > 0);
+}
+
+// Threads that each sweep the same addresses twice see only their own
+// reuse privately but one another's reuse in the shared view.
+static void check_private (void)
+{
+  setenv("BF_REUSE_THREADS", "1", 1);
+  bf_test_initialize();
+  for (int t = 0; t < 2; t++) {
+    thread sweeper([]() {
+        for (int pass = 0; pass < 2; pass++)
+          for (uint64_t address = 0; address < 100; address++)
+            touch(address);
+      });
+    sweeper.join();
+  }
+  HdrHistogram* private_hist;
+  uint64_t median_value, mad_value;
+  BF_CHECK(bf_get_private_reuse_distance(&private_hist, &median_value, &mad_value));
+  BF_CHECK(total_tally(*private_hist) == 200);
+  BF_CHECK((*private_hist)[private_hist->bin_of(99)] == 200);
+  BF_CHECK(median_value == 99);
+  BF_CHECK(mad_value == 0);
+  HdrHistogram* hist;
+  uint64_t unique_addrs;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  BF_CHECK(total_tally(*hist) == 300);
+  BF_CHECK(unique_addrs == 100);
+}
+
+// A thread that first accesses memory after the shared view has been
+// reported updates that view directly instead of logging for a consumer
+// that no longer runs.
+static void check_after_finish (void)
+{
+  setenv("BF_REUSE_THREADS", "1", 1);
+  bf_test_initialize();
+  for (int t = 0; t < 2; t++) {
+    thread sweeper([]() {
+        for (int pass = 0; pass < 2; pass++)
+          for (uint64_t address = 0; address < 100; address++)
+            touch(address);
+      });
+    sweeper.join();
+    HdrHistogram* hist;
+    uint64_t unique_addrs;
+    bf_get_reuse_distance(&hist, &unique_addrs);
+    BF_CHECK(total_tally(*hist) == 100 + 200*uint64_t(t));
+    BF_CHECK((*hist)[hist->bin_of(99)] == 100 + 200*uint64_t(t));
+    BF_CHECK(unique_addrs == 100);
+  }
+}
+
+// Sweep addresses 0 to num_addrs-1 on behalf of a function.
+static void func_sweep (KeyType_t funcID, uint64_t num_addrs)
+{
+  for (uint64_t address = 0; address < num_addrs; address++)
+    bf_reuse_dist_addrs_func(funcID, address, 1);
+}
+
+// Each function is charged with the distances of its own reuses, measured
+// against every function's accesses.
+static void check_by_func (void)
+{
+  bf_test_initialize();
+  func_sweep(1, 100);
+  func_sweep(1, 100);
+  func_sweep(2, 50);
+  key2hist_t& func_hists = bf_get_reuse_distance_by_func();
+  BF_CHECK(func_hists.size() == 2);
+  const HdrHistogram& hist1 = *func_hists[1];
+  const HdrHistogram& hist2 = *func_hists[2];
+  BF_CHECK(total_tally(hist1) == 100);
+  BF_CHECK(hist1[hist1.bin_of(99)] == 100);
+  BF_CHECK(total_tally(hist2) == 50);
+  BF_CHECK(hist2[hist2.bin_of(99)] == 50);
+  HdrHistogram* hist;
+  uint64_t unique_addrs;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  BF_CHECK(total_tally(*hist) == 150);
+}
+
+// When reuse distance is computed per thread, each function is charged
+// with its private reuse distances, summed across threads.
+static void check_by_func_threads (void)
+{
+  setenv("BF_REUSE_THREADS", "1", 1);
+  bf_test_initialize();
+  for (KeyType_t funcID = 1; funcID <= 2; funcID++) {
+    thread sweeper([=]() {
+        func_sweep(funcID, 100);
+        func_sweep(funcID, 100);
+        func_sweep(3, 10);
+      });
+    sweeper.join();
+  }
+  key2hist_t& func_hists = bf_get_reuse_distance_by_func();
+  BF_CHECK(func_hists.size() == 3);
+  for (KeyType_t funcID = 1; funcID <= 2; funcID++) {
+    const HdrHistogram& func_hist = *func_hists[funcID];
+    BF_CHECK(total_tally(func_hist) == 100);
+    BF_CHECK(func_hist[func_hist.bin_of(99)] == 100);
+  }
+  const HdrHistogram& hist3 = *func_hists[3];
+  BF_CHECK(total_tally(hist3) == 20);
+  BF_CHECK(hist3[hist3.bin_of(99)] == 20);
+}
+
+// Windows of a fixed number of accesses partition the program's reuse
+// distances and unique addresses, with the final window partial.
+static void check_windows (void)
+{
+  setenv("BF_REUSE_WINDOW", "150", 1);
+  bf_test_initialize();
+  for (int pass = 0; pass < 3; pass++)
+    for (uint64_t address = 0; address < 100; address++)
+      touch(address);
+  for (uint64_t address = 0; address < 10; address++)
+    touch(address);
+  const vector<ReuseWindow>& windows = bf_get_reuse_windows();
+  static const struct {
+    uint64_t first_access;
+    uint64_t num_accesses;
+    uint64_t unique_addrs;
+    uint64_t reuses;
+  } expected[] = {
+    {0,   150, 100, 50},
+    {150, 150, 0,   150},
+    {300, 10,  0,   10}
+  };
+  BF_CHECK(windows.size() == 3);
+  for (size_t w = 0; w < windows.size(); w++) {
+    const ReuseWindow& window = windows[w];
+    BF_CHECK(window.first_access == expected[w].first_access);
+    BF_CHECK(window.num_accesses == expected[w].num_accesses);
+    BF_CHECK(window.unique_addrs == expected[w].unique_addrs);
+    BF_CHECK(window.median == 99);
+    BF_CHECK(window.mad == 0);
+    BF_CHECK(window.bins.size() == 1);
+    BF_CHECK(get<0>(window.bins[0]) <= 99 && get<1>(window.bins[0]) >= 99);
+    BF_CHECK(get<2>(window.bins[0]) == expected[w].reuses);
+  }
+}
+
+// With the approximate tree, an address last seen more than -bf-max-rdist
+// sampled accesses ago counts as new, also after the map of last accesses
+// has been swept of such addresses.
+static void check_approx_horizon (void)
+{
+  bf_max_reuse_distance = 1000;
+  bf_reuse_error_ppm = 50000;
+  bf_test_initialize();
+  map<uint64_t, uint64_t> last_access;   // Address -> time, never pruned
+  uint64_t ref_unique = 0;
+  mt19937_64 rng(1);
+  for (uint64_t clock = 0; clock < 50000; clock++) {
+    uint64_t address = rng() % 4 == 0 ? rng() % 20000 : rng() % 100;
+    touch(address);
+    auto iter = last_access.find(address);
+    if (iter == last_access.end() || clock - iter->second > bf_max_reuse_distance)
+      ref_unique++;
+    last_access[address] = clock;
+  }
+  HdrHistogram* hist;
+  uint64_t unique_addrs;
+  bf_get_reuse_distance(&hist, &unique_addrs);
+  BF_CHECK(unique_addrs == ref_unique);
+  BF_CHECK(total_tally(*hist) == 50000 - ref_unique);
+}
+
+int main (int argc, char* argv[])
+{
+  static const struct {
+    const char* name;
+    void (*run)(void);
+  } cases[] = {
+    {"sampling",         check_sampling},
+    {"short-window",     check_short_window},
+    {"private",          check_private},
+    {"after-finish",     check_after_finish},
+    {"granularity",      check_granularity},
+    {"exact",            check_exact},
+    {"approx",           check_approx},
+    {"approx-horizon",   check_approx_horizon},
+    {"by-func",          check_by_func},
+    {"by-func-threads",  check_by_func_threads},
+    {"windows",          check_windows}
+  };
+  if (argc == 2)
+    for (auto& test_case: cases)
+      if (strcmp(argv[1], test_case.name) == 0) {
+        test_case.run();
+        return 0;
+      }
+  cerr << "Usage: " << argv[0] << " <case>\n";
+  return 1;
+}
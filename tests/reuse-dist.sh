@@ -0,0 +1,25 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the reuse-distance      #
+# model produces known answers        #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Run each case in a fresh process because each configures the run-time
+# library differently.
+for case in sampling short-window private after-finish granularity exact \
+    approx approx-horizon by-func by-func-threads windows ; do
+  ./reuse-dist $case
+done
+
+# Windows must be a positive number of accesses or seconds.
+if env BF_REUSE_WINDOW=10x ./reuse-dist sampling 2> reuse-dist.err ; then
+  exit 1
+fi
+grep -q 'BF_REUSE_WINDOW must be a positive number' reuse-dist.err
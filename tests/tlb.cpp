@@ -0,0 +1,37 @@
+/*
+ * Touch a known number of pages of each size so that the TLB model's
+ * page counts can be checked
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <thread>
+#include "bftest.h"
+
+// Sweep a range of 4 KB pages, touching each one twice in a row.
+static void sweep (uint64_t base, uint64_t num_pages)
+{
+  for (uint64_t page = 0; page < num_pages; page++) {
+    bf_touch_cache(base + page*4096, 8, 0);
+    bf_touch_cache(base + page*4096 + 8, 8, 1);
+  }
+}
+
+int main (void)
+{
+  bf_cache_model = 1;
+  bf_line_size = 64;
+  bf_max_set_bits = 4;
+  bf_test_initialize();
+
+  // The main thread touches 1000 4 KB pages, which lie in two 2 MB pages
+  // and one 1 GB page, three times over.  A second thread touches the
+  // first ten of those pages again.  TLBs are per thread, so both
+  // threads' pages count as distinct.
+  const uint64_t base = 0x40000000;
+  for (int pass = 0; pass < 3; pass++)
+    sweep(base, 1000);
+  thread other(sweep, base, 10);
+  other.join();
+  return 0;
+}
@@ -0,0 +1,25 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the TLB model counts    #
+# the pages of each size a program    #
+# touches                             #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Model three page sizes at once.
+output=`env BF_TLB_PAGE_SIZES=4K,2M,1G ./tlb`
+echo "$output" | grep -q ' 1010 distinct 4096-byte pages accessed'
+echo "$output" | grep -q ' 3 distinct 2097152-byte pages accessed'
+echo "$output" | grep -q ' 2 distinct 1073741824-byte pages accessed'
+
+# Page sizes must be powers of two.
+if env BF_TLB_PAGE_SIZES=4K,3K ./tlb 2> tlb.err ; then
+  exit 1
+fi
+grep -q 'page sizes must be powers of two' tlb.err
@@ -0,0 +1,160 @@
+/*
+ * Check the unique-byte trackers against known answers.  The first
+ * argument names the case to run.
+ *
+ * By Scott Pakin <pakin@lanl.gov>
+ */
+
+#include <cstring>
+#include <thread>
+#include "bftest.h"
+
+// Touch overlapping ranges of memory from several threads, some of which
+// exit before and some after the main thread requests results, and check the
+// per-thread and whole-program tallies.
+static void check_threads (void (*assoc)(uint64_t, uint64_t),
+                           bool (*get_threads)(vector<uint64_t>*, uint64_t*),
+                           uint64_t (*tally)(void))
+{
+  setenv("BF_UNIQUE_THREADS", "1", 1);
+  bf_unique_bytes = 1;
+  bf_test_initialize();
+
+  // The main thread touches [0x10000, 0x11000).  Three more threads touch
+  // [0x10800, 0x12800), [0x12000, 0x13000), and [0x20000, 0x20100), each a
+  // few bytes at a time and twice over.
+  assoc(0x10000, 0x1000);
+  const uint64_t ranges[3][2] = {
+    {0x10800, 0x2000},
+    {0x12000, 0x1000},
+    {0x20000, 0x100}
+  };
+  for (auto& range: ranges) {
+    thread toucher([=]() {
+        for (int pass = 0; pass < 2; pass++)
+          for (uint64_t ofs = 0; ofs < range[1]; ofs += 8)
+            assoc(range[0] + ofs, 8);
+      });
+    toucher.join();
+  }
+
+  // The main thread's table is folded when results are requested, after
+  // which its accesses go straight to the global table.
+  vector<uint64_t> per_thread;
+  uint64_t shared;
+  BF_CHECK(get_threads(&per_thread, &shared));
+  BF_CHECK(per_thread.size() == 4);
+  BF_CHECK(per_thread[0] == 0x1000);
+  BF_CHECK(per_thread[1] == 0x2000);
+  BF_CHECK(per_thread[2] == 0x1000);
+  BF_CHECK(per_thread[3] == 0x100);
+  BF_CHECK(shared == 0x800 + 0x800);
+  BF_CHECK(tally() == 0x3000 + 0x100);
+  assoc(0x30000, 0x10);
+  BF_CHECK(tally() == 0x3000 + 0x100 + 0x10);
+}
+
+// Check per-thread tracking of unique bytes.
+static void check_threads_bits (void)
+{
+  check_threads(bf_assoc_addresses_with_prog,
+                bf_get_thread_unique_bytes,
+                bf_tally_unique_addresses);
+}
+
+// Check per-thread tracking of the memory footprint.
+static void check_threads_words (void)
+{
+  bf_mem_footprint = 1;
+  check_threads(bf_assoc_addresses_with_prog_tb,
+                bf_get_thread_unique_bytes_tb,
+                bf_tally_unique_addresses_tb);
+}
+
+// Touch 150 words and then the first 100 of them again, and check that
+// windows of 100 accesses partition the footprint's growth.
+static void check_windows (void (*assoc)(uint64_t, uint64_t),
+                           uint64_t (*tally)(void))
+{
+  setenv("BF_UNIQUE_WINDOW", "100", 1);
+  bf_unique_bytes = 1;
+  bf_test_initialize();
+  for (uint64_t word = 0; word < 150; word++)
+    assoc(0x10000 + word*8, 8);
+  for (uint64_t word = 0; word < 100; word++)
+    assoc(0x10000 + word*8, 8);
+  const vector<UniqueWindow>& windows = bf_get_unique_windows();
+  static const struct {
+    uint64_t first_access;
+    uint64_t num_accesses;
+    uint64_t new_bytes;
+    uint64_t total_bytes;
+  } expected[] = {
+    {0,   100, 800, 800},
+    {100, 100, 400, 1200},
+    {200, 50,  0,   1200}
+  };
+  BF_CHECK(windows.size() == 3);
+  for (size_t w = 0; w < windows.size(); w++) {
+    BF_CHECK(windows[w].first_access == expected[w].first_access);
+    BF_CHECK(windows[w].num_accesses == expected[w].num_accesses);
+    BF_CHECK(windows[w].new_bytes == expected[w].new_bytes);
+    BF_CHECK(windows[w].total_bytes == expected[w].total_bytes);
+  }
+  BF_CHECK(tally() == 1200);
+}
+
+// Check footprint-growth windows of unique bytes.
+static void check_windows_bits (void)
+{
+  check_windows(bf_assoc_addresses_with_prog, bf_tally_unique_addresses);
+}
+
+// Check footprint-growth windows of the memory footprint.
+static void check_windows_words (void)
+{
+  bf_mem_footprint = 1;
+  check_windows(bf_assoc_addresses_with_prog_tb, bf_tally_unique_addresses_tb);
+}
+
+// Zero-length ranges, as a memset or memcpy of zero bytes produces, touch
+// nothing in any of the address-based analyses.
+static void check_zero_length (void)
+{
+  bf_unique_bytes = 1;
+  bf_mem_footprint = 1;
+  bf_cache_model = 1;
+  bf_test_initialize();
+  bf_assoc_addresses_with_prog(0x10000, 0);
+  bf_assoc_addresses_with_prog_tb(0x10000, 0);
+  bf_reuse_dist_addrs_prog(0x10000, 0);
+  bf_touch_cache(0x10000, 0, 1);
+  BF_CHECK(bf_tally_unique_addresses() == 0);
+  BF_CHECK(bf_tally_unique_addresses_tb() == 0);
+  uint64_t sampled_addrs, total_addrs;
+  bf_get_reuse_sampling(&sampled_addrs, &total_addrs);
+  BF_CHECK(total_addrs == 0);
+  BF_CHECK(bf_get_private_cache_accesses() == 0);
+}
+
+int main (int argc, char* argv[])
+{
+  static const struct {
+    const char* name;
+    void (*run)(void);
+  } cases[] = {
+    {"threads-bits",  check_threads_bits},
+    {"threads-words", check_threads_words},
+    {"windows-bits",  check_windows_bits},
+    {"windows-words", check_windows_words},
+    {"zero-length",   check_zero_length}
+  };
+  if (argc == 2)
+    for (auto& test_case: cases)
+      if (strcmp(argv[1], test_case.name) == 0) {
+        test_case.run();
+        return 0;
+      }
+  cerr << "Usage: " << argv[0] << " <case>\n";
+  return 1;
+}
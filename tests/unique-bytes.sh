@@ -0,0 +1,24 @@
+#! /bin/sh
+
+#######################################
+# Ensure that the unique-byte         #
+# trackers produce known answers      #
+#                                     #
+# By Scott Pakin <pakin@lanl.gov>     #
+#######################################
+
+# Log everything we do.  Fail on the first error.
+set -e
+set -x
+
+# Run each case in a fresh process because each configures the run-time
+# library differently.
+for case in threads-bits threads-words windows-bits windows-words zero-length ; do
+  ./unique-bytes $case
+done
+
+# Footprint-growth windows cannot be combined with per-thread tables.
+if env BF_UNIQUE_THREADS=1 BF_UNIQUE_WINDOW=1000 ./unique-bytes threads-bits 2> unique-bytes.err ; then
+  exit 1
+fi
+grep -q 'BF_UNIQUE_WINDOW cannot be combined with BF_UNIQUE_THREADS' unique-bytes.err
@@ -306,6 +306,7 @@ LocalState::LocalState (int argc, char* argv[])
   short_evname["Calls to memcpy and memmove"] = "Memcpy";
   short_evname["Bytes loaded and stored by memcpy and memmove"] = "Memcpy_bytes";
   short_evname["Unique bytes"] = "Uniq_bytes";
+  short_evname["Unique bytes standard error"] = "Uniq_bytes_err";
   short_evname["Invocations"] = "Invokes";
 }
 